@@ -1,15 +1,94 @@
 #pragma once
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
 
+// MSB-first bit reader. Keeps up to 64 bits left-aligned in bitbuf_ and
+// refills it with 8-byte loads, so codes are read with peek()/consume().
 class BitReader {
 public:
+    BitReader(const uint8_t* data, size_t size);
     BitReader(const std::vector<uint8_t>& buffer);
+    // Fills dst with up to `capacity` more bytes of the stream and returns how many; 0 at its end
+    using Source = std::function<size_t(uint8_t* dst, size_t capacity)>;
+    // Reader over a stream that is not held in memory (e.g. part of a file): bytes
+    // are pulled from source into an owned buffer of buffer_size bytes as needed
+    BitReader(Source source, size_t buffer_size);
+    // A source reader points into its own buffer, so readers are moved, never copied
+    BitReader(BitReader&&) = default;
+    BitReader& operator=(BitReader&&) = default;
+    BitReader(const BitReader&) = delete;
+    BitReader& operator=(const BitReader&) = delete;
     bool readBit();
     uint64_t readBits(unsigned count);
     bool hasMoreBits() const;
+
+    // Next `count` bits (count <= 56) without advancing; zero-padded past the end
+    uint64_t peek(unsigned count) {
+        if (bitcount_ < count) refill();
+        return count == 0 ? 0 : bitbuf_ >> (64 - count);
+    }
+    // Advance past `count` bits (count <= 56); stops at the end of the data
+    void consume(unsigned count) {
+        if (bitcount_ < count) refill();
+        if (count > bitcount_) count = bitcount_;
+        bitbuf_ <<= count;
+        bitcount_ -= count;
+    }
+    // For a source reader, only the bits pulled in so far
+    size_t bitsRemaining() const { return (size_ - pos_) * 8 + bitcount_; }
+
+    // Bits already in the bit buffer. After peek(n) this is at least n, or
+    // everything left if fewer than n bits remain.
+    unsigned bitsBuffered() const { return bitcount_; }
+    // consume() without refill or clamping; count must be <= bitsBuffered()
+    void skip(unsigned count) {
+        bitbuf_ <<= count;
+        bitcount_ -= count;
+    }
+
 private:
-    const std::vector<uint8_t>& buffer_;
-    size_t byte_pos_;
-    int bit_pos_;
+    void refill() {
+        if (pos_ + 8 <= size_) {
+            // Bits past bitcount_ already hold the same stream data, so OR-ing the load is safe
+            uint64_t word;
+#if (defined(__GNUC__) || defined(__clang__)) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            std::memcpy(&word, data_ + pos_, sizeof(word));
+            word = __builtin_bswap64(word);
+#else
+            word = loadBigEndian(data_ + pos_);
+#endif
+            bitbuf_ |= word >> bitcount_;
+            unsigned bytes = (63 - bitcount_) >> 3;
+            pos_ += bytes;
+            bitcount_ += bytes * 8;
+            return;
+        }
+        if (source_ && fetch()) {
+            refill();
+            return;
+        }
+        while (bitcount_ <= 56 && pos_ < size_) {
+            bitbuf_ |= static_cast<uint64_t>(data_[pos_++]) << (56 - bitcount_);
+            bitcount_ += 8;
+        }
+    }
+    // Move the unread bytes to the front of owned_ and pull more from source_;
+    // false if nothing was added
+    bool fetch();
+    static uint64_t loadBigEndian(const uint8_t* p) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;       // next byte to load into bitbuf_
+    uint64_t bitbuf_;  // unread bits, left-aligned
+    unsigned bitcount_; // valid bits in bitbuf_
+    Source source_;     // set for a source reader; data_ then points into owned_
+    std::vector<uint8_t> owned_;
 };
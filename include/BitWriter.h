@@ -1,18 +1,31 @@
 #pragma once
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 #include <ostream>
 
+// MSB-first bit writer. Bits collect in a 64-bit accumulator and are stored
+// eight bytes at a time into a buffer that always keeps 8 bytes of slack.
 class BitWriter {
 public:
     BitWriter();
+    // Preallocate room for about expected_bytes of output (e.g. from code lengths x histogram)
+    explicit BitWriter(size_t expected_bytes);
+    void reserve(size_t expected_bytes);
+    // Start over empty, keeping the buffer's memory for the next use
+    void clear();
     void writeBit(bool bit);
     void writeBits(uint64_t value, unsigned count);
     void flush();
-    const std::vector<uint8_t>& getBuffer() const;
+    // Completed bytes written so far, data()[0 .. size()) (call flush() first to
+    // include a partial byte). The buffer's slack stays allocated for reuse.
+    const uint8_t* data() const { return buffer_.data(); }
+    size_t size() const { return pos_; }
     void writeToStream(std::ostream& os);
 private:
+    void grow();
     std::vector<uint8_t> buffer_;
-    uint8_t current_byte_;
-    int bit_pos_;
+    size_t pos_;        // bytes fully written
+    uint64_t acc_;      // pending bits, left-aligned
+    unsigned acc_bits_; // number of pending bits (< 8 between calls)
 };
@@ -11,6 +11,8 @@ public:
     static uint32_t calculate(const std::vector<uint8_t>& data);
     static uint32_t calculate(const std::string& data);
     static uint32_t calculate(const uint8_t* data, size_t length);
+    // Extends a CRC over more data: update(calculate(a), b) == calculate(a followed by b)
+    static uint32_t update(uint32_t crc, const uint8_t* data, size_t length);
     static std::string toHex(uint32_t crc);
     static uint32_t fromHex(const std::string& hex);
 };
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BitWriter.h"
+#include "CompressionSettings.h"
+#include "HuffmanDecoder.h"
+#include "LZ77.h"
+
+namespace huffman {
+
+// Buffers of the LZ77 + Huffman encoder that survive between blocks
+struct CompressScratch {
+    LZ77::MatchState matches;                  // hash chains of the greedy parser
+    std::vector<LZ77::Token> tokens;
+    std::vector<uint64_t> litlen_freq, dist_freq;
+    std::vector<uint8_t> litlen_lens, dist_lens;
+    std::vector<uint32_t> litlen_codes, dist_codes;
+    BitWriter writers[INTERLEAVED_STREAMS];
+    std::vector<unsigned char> payload;        // jump table + streams of the last block
+};
+
+// Decode tables that survive between buffers; rebuilt only when the code lengths change
+struct DecompressScratch {
+    HuffmanDecoder litlen, dist;
+    std::vector<uint8_t> litlen_lens, dist_lens; // lengths the decoders were built from
+    std::vector<BitReader> readers;
+    std::vector<uint8_t> staging;                // output of images that do not record their size
+};
+
+// Largest compressed image CompressContext::compress can produce for size input
+// bytes; a compressInto destination of this capacity never fails for lack of room
+size_t compressBound(size_t size);
+
+// Decompressed size recorded in a compressed image (HUF_LZV6, HUF_STRM, HUF_PAR2,
+// or HUF_PAR whose chunks all carry their size). False when the format does not record it.
+bool decompressedSize(const uint8_t* data, size_t size, uint64_t& decompressed_size);
+// Same for a compressed file, reading only the header, end marker or chunk index
+// (all of an older HUF_PAR file). False if the file cannot be read.
+bool decompressedSize(const std::string& path, uint64_t& decompressed_size);
+
+
+// Reusable compressor for many small buffers. Histograms, code tables, bit
+// writer buffers and LZ77 hash chains stay allocated between calls, so repeated
+// calls do not pay for setting them up again. Use one context per thread.
+class CompressContext {
+public:
+    explicit CompressContext(const CompressionSettings& settings = CompressionSettings()) : settings_(settings) {}
+
+    const CompressionSettings& settings() const { return settings_; }
+    void setSettings(const CompressionSettings& settings) { settings_ = settings; }
+
+    // Replaces out with the compressed image of data[0..size) (same format as
+    // Compressor::compress). Throws HuffmanError on failure.
+    void compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+    void compress(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) { compress(in.data(), in.size(), out); }
+    // Writes the image straight to dst and returns its size. Throws HuffmanError
+    // if it needs more than capacity bytes.
+    size_t compressInto(const uint8_t* data, size_t size, uint8_t* dst, size_t capacity);
+
+private:
+    CompressionSettings settings_;
+    CompressScratch scratch_;
+};
+
+// Reusable decompressor; keeps its decode tables between calls. Use one context per thread.
+class DecompressContext {
+public:
+    // Replaces out with the decompressed contents of a complete compressed image.
+    // Throws HuffmanError if the data is invalid or corrupted.
+    void decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+    void decompress(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) { decompress(in.data(), in.size(), out); }
+    // Writes the decompressed data to dst and returns its size. Images that record
+    // their size decode straight into dst; others decode into a reused staging
+    // buffer first. Throws HuffmanError if the data needs more than capacity bytes.
+    size_t decompressInto(const uint8_t* data, size_t size, uint8_t* dst, size_t capacity);
+
+private:
+    DecompressScratch scratch_;
+};
+
+} // namespace huffman
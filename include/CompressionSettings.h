@@ -8,6 +8,13 @@ using namespace std;
 
 namespace huffman {
 
+// Interleaved bitstreams per HUF4 chunk / HUF_LZV6 block; symbol (or token) i goes to stream i % 4
+constexpr unsigned INTERLEAVED_STREAMS = 4;
+
+// With chunk_dictionary, every this many chunks one starts unprimed, so a range
+// read decodes at most this many - 1 chunks before the range
+constexpr size_t DICTIONARY_RESTART_CHUNKS = 16;
+
 struct CompressionSettings {
     unsigned level = 5; // 1..9
     enum Mode { FAST = 0, DEFAULT = 1, BEST = 2 } mode = DEFAULT;
@@ -16,6 +23,12 @@ struct CompressionSettings {
     unsigned extra_passes = 0;
     bool sampling = false;
     bool prefer_speed = false;
+    unsigned max_chain = 32; // LZ77 hash-chain candidates tried per position
+    unsigned max_code_length = 15; // longest Huffman code; shorter codes keep decode tables small
+    unsigned threads = 0; // parallel workers per call on the shared pool; 0 = all hardware threads
+    bool chunk_lz77 = false; // compressParallel: LZ77 + Huffman chunks (HLZ5) instead of plain Huffman (HUF4)
+    size_t chunk_dictionary = 0; // bytes of the previous chunk primed as LZ77 history (max 32 KiB); primed chunks decode in order,
+                                 // and every DICTIONARY_RESTART_CHUNKS-th chunk (0, 16, 32, ...) is left unprimed
     
     // Additional settings for fine-tuning
     bool verbose = false;
@@ -35,6 +48,8 @@ inline CompressionSettings make_settings_from_level(unsigned level) {
         s.extra_passes = 0;
         s.sampling = true;
         s.prefer_speed = true;
+        s.max_chain = 8;
+        s.max_code_length = 11; // every code fits the decoder's primary table
     } else if (level <= 6) {
         s.level = level;
         s.mode = CompressionSettings::DEFAULT;
@@ -43,6 +58,8 @@ inline CompressionSettings make_settings_from_level(unsigned level) {
         s.extra_passes = 0;
         s.sampling = false;
         s.prefer_speed = false;
+        s.max_chain = 32;
+        s.max_code_length = 15;
     } else {
         s.level = level;
         s.mode = CompressionSettings::BEST;
@@ -51,6 +68,8 @@ inline CompressionSettings make_settings_from_level(unsigned level) {
         s.extra_passes = 1;
         s.sampling = false;
         s.prefer_speed = false;
+        s.max_chain = 128;
+        s.max_code_length = 15;
     }
     return s;
 }
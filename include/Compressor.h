@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "CompressionSettings.h"
 
 using namespace std;
@@ -9,6 +10,8 @@ class Compressor {
 public:
     bool compress(const string& inPath, const string& outPath);
     bool compress(const string& inPath, const string& outPath, const huffman::CompressionSettings& settings);
+    // In-memory codec; the file overloads read the input, call it and write the result
+    bool compress(const vector<unsigned char>& input, vector<unsigned char>& output, const huffman::CompressionSettings& settings);
     bool compressParallel(const string& inPath, const string& outPath, const huffman::CompressionSettings& settings, size_t chunkSize);
     bool compressInternal(const string& inPath, const string& outPath, const huffman::CompressionSettings& settings);
 };
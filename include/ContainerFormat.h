@@ -0,0 +1,96 @@
+#ifndef CONTAINER_FORMAT_H
+#define CONTAINER_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace huffman {
+
+// Seekable parallel container (HUF_PAR2):
+//   magic "HUF_PAR2" | chunk blobs (HUF4 / HLZ5) | index (one entry per chunk) | footer
+// Footer (last PAR2_FOOTER_SIZE bytes): index offset (u64) | chunk count (u64) |
+// CRC32 of the index (u32) | "P2IX". All integers are little-endian.
+// A legacy HUF_PAR file whose chunk count starts with byte '2' has the same first
+// eight bytes, so readers also require the footer magic.
+const char PAR2_MAGIC[] = "HUF_PAR2";
+const size_t PAR2_MAGIC_SIZE = 8;
+const char PAR2_FOOTER_MAGIC[] = "P2IX";
+const size_t PAR2_FOOTER_SIZE = 8 + 8 + 4 + 4;
+const size_t CHUNK_INDEX_ENTRY_SIZE = 8 * 4 + 4 + 4;
+
+// Framed stream (HUF_STRM), written block by block without seeking:
+//   magic "HUF_STRM" | frames | end marker
+// Frame: blob size (u32, > 0) | HLZ5 chunk blob whose dictionary is the tail of the
+// previous block. End marker: u32 0 | total original size (u64) | CRC32 of the
+// original data (u32). All integers are little-endian.
+const char STREAM_MAGIC[] = "HUF_STRM";
+const size_t STREAM_MAGIC_SIZE = 8;
+const size_t STREAM_FRAME_HEADER_SIZE = 4;
+const size_t STREAM_TRAILER_SIZE = 8 + 4;
+// Block size when CompressionSettings::block_size is 0, and the largest block a
+// stream may use, which bounds the decoder's memory
+const size_t STREAM_DEFAULT_BLOCK_SIZE = 1 << 20;
+const size_t STREAM_MAX_BLOCK_SIZE = 16 << 20;
+
+// Single-stream image (HUF_LZV6): magic "HUF_LZV6" | original size (u64 LE) |
+// CRC32 of the original data (u32 LE) | 286 literal/length and 30 distance code
+// lengths | CRC32 of the payload (u32) | jump table + 4 streams of LZ77::Token
+// symbols. Empty input stops after the CRC32 of the original data.
+const char LZV6_MAGIC[] = "HUF_LZV6";
+const size_t LZV6_MAGIC_SIZE = 8;
+const size_t LZV6_SIZE_FIELDS = 8 + 4;
+
+// Whether data (at least LZV6_MAGIC_SIZE bytes) starts a HUF_LZV6 image
+inline bool isSizedImage(const unsigned char* data) {
+    return std::memcmp(data, LZV6_MAGIC, LZV6_MAGIC_SIZE) == 0;
+}
+
+// Index entry for one chunk of a HUF_PAR2 container
+struct ChunkIndexEntry {
+    uint64_t compressed_offset = 0; // Offset of the chunk blob from the start of the file
+    uint64_t compressed_size = 0;   // Size of the chunk blob
+    uint64_t original_offset = 0;   // Offset of the chunk's first byte in the decompressed data
+    uint64_t original_size = 0;     // Decompressed size of the chunk
+    uint32_t checksum = 0;          // CRC32 of the chunk's decompressed data
+    uint32_t dict_size = 0;         // HLZ5 bytes primed from the previous chunk (0 = independent)
+};
+
+inline void appendLittleEndian(std::vector<unsigned char>& out, uint64_t value, size_t bytes) {
+    for (size_t b = 0; b < bytes; ++b) out.push_back(static_cast<unsigned char>((value >> (8 * b)) & 0xFF));
+}
+
+inline void storeLittleEndian(unsigned char* out, uint64_t value, size_t bytes) {
+    for (size_t b = 0; b < bytes; ++b) out[b] = static_cast<unsigned char>((value >> (8 * b)) & 0xFF);
+}
+
+inline uint64_t readLittleEndian(const unsigned char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t b = 0; b < bytes; ++b) value |= static_cast<uint64_t>(data[b]) << (8 * b);
+    return value;
+}
+
+inline void appendIndexEntry(std::vector<unsigned char>& out, const ChunkIndexEntry& entry) {
+    appendLittleEndian(out, entry.compressed_offset, 8);
+    appendLittleEndian(out, entry.compressed_size, 8);
+    appendLittleEndian(out, entry.original_offset, 8);
+    appendLittleEndian(out, entry.original_size, 8);
+    appendLittleEndian(out, entry.checksum, 4);
+    appendLittleEndian(out, entry.dict_size, 4);
+}
+
+inline ChunkIndexEntry parseIndexEntry(const unsigned char* data) {
+    ChunkIndexEntry entry;
+    entry.compressed_offset = readLittleEndian(data, 8);
+    entry.compressed_size = readLittleEndian(data + 8, 8);
+    entry.original_offset = readLittleEndian(data + 16, 8);
+    entry.original_size = readLittleEndian(data + 24, 8);
+    entry.checksum = static_cast<uint32_t>(readLittleEndian(data + 32, 4));
+    entry.dict_size = static_cast<uint32_t>(readLittleEndian(data + 36, 4));
+    return entry;
+}
+
+} // namespace huffman
+
+#endif // CONTAINER_FORMAT_H
@@ -1,8 +1,21 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 class Decompressor {
 public:
     bool decompress(const std::string& inPath, const std::string& outPath);
+    // The file overload reads the input in pieces and writes output as it is decoded;
+    // this one decodes a whole image held in memory
+    bool decompress(const std::vector<unsigned char>& input, std::vector<unsigned char>& output);
+
+    // Decode bytes [offset, offset + length) of a HUF_PAR2 file into out, reading
+    // only the chunks that cover the range. A primed chunk also needs the chunks
+    // back to the last unprimed one, at most DICTIONARY_RESTART_CHUNKS - 1 more.
+    // A range past the end is clipped.
+    bool decompressRange(const std::string& inPath, uint64_t offset, size_t length,
+                         std::vector<unsigned char>& out);
 };
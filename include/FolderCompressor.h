@@ -55,13 +55,16 @@ private:
     std::string makeRelativePath(const std::string& base_path, const std::string& full_path);
     bool writeArchiveHeader(std::ofstream& out, const ArchiveMetadata& metadata);
     bool readArchiveHeader(std::ifstream& in, ArchiveMetadata& metadata);
-    bool compressSingleFileToArchive(const std::string& file_path,
-                                     std::ofstream& archive_stream,
-                                     FileEntry& entry,
-                                     const CompressionSettings& settings);
-    bool decompressSingleFileFromArchive(std::ifstream& archive_stream,
-                                        const FileEntry& entry,
-                                        const std::string& output_path);
+    // Per-file work is split so the compress/decompress step can run on the
+    // shared thread pool while archive reads and writes stay sequential.
+    std::vector<uint8_t> packFileForArchive(const std::string& file_path,
+                                            FileEntry& entry,
+                                            const CompressionSettings& settings);
+    std::vector<uint8_t> readFileFromArchive(std::ifstream& archive_stream,
+                                             const FileEntry& entry);
+    bool restoreFileFromArchive(std::vector<uint8_t>& file_data,
+                                const FileEntry& entry,
+                                const std::string& output_path);
     void createDirectoryRecursive(const std::string& path);
     uint32_t calculateCRC32(const std::vector<uint8_t>& data);
 };
@@ -6,6 +6,8 @@
 #include <ostream>
 #include "CompressionSettings.h"
 #include "ErrorHandler.h"
+#include "CodecContext.h"
+#include "StreamCodec.h"
 
 using namespace std;
 
@@ -24,7 +26,8 @@ struct CompressionResult {
     bool checksum_verified = false;
 };
 
-// Stream-based API
+// Stream-based API. compress writes a framed HUF_STRM stream block by block with
+// StreamCompressor; decompress accepts any format, decoding HUF_STRM incrementally.
 CompressionResult compress(std::istream& in, std::ostream& out, const CompressionSettings& settings = CompressionSettings());
 CompressionResult decompress(std::istream& in, std::ostream& out);
 
@@ -32,10 +35,29 @@ CompressionResult decompress(std::istream& in, std::ostream& out);
 std::vector<uint8_t> compressBuffer(const std::vector<uint8_t>& in, const CompressionSettings& settings = CompressionSettings());
 std::vector<uint8_t> decompressBuffer(const std::vector<uint8_t>& in);
 
+// Zero-copy buffer API: output goes to caller memory (e.g. a send buffer or a
+// mapped region). compressBound(size) (CodecContext.h) is always enough room
+// for compressInto.
+const size_t DECOMPRESS_ERROR = static_cast<size_t>(-1);
+const uint64_t SIZE_UNKNOWN = ~uint64_t(0);
+// Bytes written to dst, or 0 on failure or if capacity is too small
+size_t compressInto(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity, const CompressionSettings& settings = CompressionSettings());
+// Bytes written to dst, or DECOMPRESS_ERROR on failure or if capacity is too small
+size_t decompressInto(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+// Decompressed size recorded in a compressed image without decoding it, or
+// SIZE_UNKNOWN if its format does not record one
+uint64_t getDecompressedSize(const uint8_t* src, size_t size);
+// Same for a compressed file without decoding it, so callers can preallocate or
+// reject oversized inputs up front
+uint64_t getDecompressedSize(const std::string& path);
+
 // File API with detailed results
 CompressionResult compressFile(const std::string& inPath, const std::string& outPath, const CompressionSettings& settings = CompressionSettings());
 CompressionResult decompressFile(const std::string& inPath, const std::string& outPath);
 
+// Random access into a seekable parallel container (HUF_PAR2); empty on failure
+std::vector<uint8_t> decompressRange(const std::string& path, uint64_t offset, size_t length);
+
 // Utility functions
 bool isValidCompressedFile(const std::string& path);
 size_t getCompressedFileSize(const std::string& path);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "BitReader.h"
+
+// Table-driven canonical Huffman decoder. The primary table is indexed by the
+// next PRIMARY_BITS bits of the stream; codes longer than that go through a
+// secondary table selected by their primary-width prefix.
+class HuffmanDecoder {
+public:
+    static constexpr unsigned PRIMARY_BITS = 11;
+
+    HuffmanDecoder() = default;
+    // code_lengths is indexed by symbol; 0 means the symbol is unused
+    explicit HuffmanDecoder(const std::vector<uint8_t>& code_lengths);
+    void build(const std::vector<uint8_t>& code_lengths);
+
+    // Decodes one symbol. Returns -1 if the bits left do not hold a complete valid code.
+    int decode(BitReader& reader) const {
+        uint64_t bits = reader.peek(primary_bits_);
+        const Entry* e = &table_[bits];
+        if (e->length == 0) {
+            if (e->sub_bits == 0) return -1;
+            uint64_t sub = reader.peek(primary_bits_ + e->sub_bits) & ((uint64_t(1) << e->sub_bits) - 1);
+            e = &table_[e->value + sub];
+            if (e->length == 0) return -1;
+        }
+        // Every peek above refilled as far as the data allows, so this is an end-of-data check
+        if (e->length > reader.bitsBuffered()) return -1;
+        reader.skip(e->length);
+        return static_cast<int>(e->value);
+    }
+
+    // Optional multi-symbol mode: one lookup on the primary-width bits yields
+    // up to MAX_LITERALS consecutive literals (symbols < 256) whose codes fit.
+    static constexpr unsigned MAX_LITERALS = 3;
+    void buildMultiSymbol();
+    bool hasMultiSymbol() const { return !multi_.empty(); }
+
+    // Decodes up to MAX_LITERALS literals into out. Returns how many were
+    // decoded, or 0 if the next code is not a short literal (use decode()).
+    unsigned decodeLiterals(BitReader& reader, uint8_t* out) const {
+        const uint32_t m = multi_[reader.peek(primary_bits_)];
+        const unsigned count = m >> 28;
+        const unsigned length = (m >> 24) & 0xF;
+        if (count == 0 || length > reader.bitsBuffered()) return 0;
+        reader.skip(length);
+        out[0] = static_cast<uint8_t>(m);
+        out[1] = static_cast<uint8_t>(m >> 8);
+        out[2] = static_cast<uint8_t>(m >> 16);
+        return count;
+    }
+
+    bool empty() const { return max_length_ == 0; }
+    unsigned maxLength() const { return max_length_; }
+
+private:
+    struct Entry {
+        uint32_t value = 0;   // symbol, or first index of the secondary table for links
+        uint8_t length = 0;   // full code length; 0 for links and unused slots
+        uint8_t sub_bits = 0; // links only: bits that index the secondary table
+    };
+    std::vector<Entry> table_ = std::vector<Entry>(1);
+    // Multi-symbol entries packed as symbols (bits 0-23, first symbol lowest),
+    // total code length (bits 24-27) and literal count (bits 28-29; 0 = use decode())
+    std::vector<uint32_t> multi_;
+    unsigned primary_bits_ = 0;
+    unsigned max_length_ = 0;
+};
@@ -3,6 +3,8 @@
 #include "HuffmanNode.h"
 #include <memory>
 #include <vector>
+#include <array>
+#include <cstdint>
 #include <unordered_map>
 #include <string>
 
@@ -14,24 +16,48 @@ public:
     std::string toDot() const;
     using CodeTable = unordered_map<unsigned char, string>;
     using CodeLenTable = unordered_map<unsigned char, int>;
+    // canonical code value (MSB-first) and its bit length; length 0 = unused byte
+    struct Code {
+        uint32_t code = 0;
+        uint8_t length = 0;
+    };
+    using CodeArray = std::array<Code, 256>;
+
+    // longest code used unless a caller asks for another limit
+    static constexpr unsigned DEFAULT_MAX_CODE_LENGTH = 15;
 
     HuffmanTree() = default;
 
-    // build from frequency table
-    void build(const unordered_map<unsigned char, uint64_t>& freq);
+    // build from frequency table (computes code lengths only; no node allocation)
+    void build(const unordered_map<unsigned char, uint64_t>& freq, unsigned max_length = DEFAULT_MAX_CODE_LENGTH);
+    // same, from a 256-entry array indexed by byte
+    void build(const vector<uint64_t>& freq, unsigned max_length = DEFAULT_MAX_CODE_LENGTH);
 
-    // generate code table
+    // generate code table (canonical codes)
     CodeTable getCodes() const;
 
     // canonical code table (for header)
     CodeLenTable getCodeLengths() const;
     CodeTable getCanonicalCodes() const;
+    // canonical codes as a flat table indexed by byte, ready for BitWriter::writeBits
+    CodeArray getCodeArray() const;
+
+    // code lengths for an arbitrary alphabet indexed by symbol (0 = unused),
+    // computed in place over the sorted frequencies (Moffat-Katajainen); if a
+    // code would exceed max_length the lengths are rebuilt with package-merge.
+    // max_length is raised if it cannot fit the number of used symbols.
+    static vector<uint8_t> buildLengths(const vector<uint64_t>& freq, unsigned max_length = DEFAULT_MAX_CODE_LENGTH);
+    // canonical code values for those lengths, assigned in (length, symbol) order
+    static vector<uint32_t> canonicalCodes(const vector<uint8_t>& lengths);
 
     // serialize / deserialize (stubs)
     vector<unsigned char> serialize() const;
     void deserialize(const vector<unsigned char>& data);
 
 private:
-    shared_ptr<HuffmanNode> root;
-    void buildCodes(const shared_ptr<HuffmanNode>& node, const string& prefix, CodeTable& table) const;
+    vector<uint64_t> freq_;      // per-byte frequencies from build()
+    vector<uint8_t> lengths_;    // per-byte code lengths, 0 = unused
+    shared_ptr<HuffmanNode> root; // explicit tree, only set by deserialize()
+    // explicit node tree for toDot()/serialize(), rebuilt from the canonical codes when needed
+    shared_ptr<HuffmanNode> explicitTree() const;
 };
@@ -5,13 +5,79 @@
 
 class LZ77 {
 public:
+    // A match of `length` bytes starting `offset` bytes back, or with length 0 the
+    // literal `next`. Matches need no literal after them, so two may follow each other.
     struct Token {
         uint16_t offset;
         uint16_t length;
         uint8_t next;
     };
-    static std::vector<Token> compress(const std::vector<uint8_t>& data, size_t window = 4096, size_t lookahead = 18);
+    struct Match {
+        uint16_t length;
+        uint16_t offset;
+    };
+    // Bit prices for the optimal parser. A literal token costs literal_token + literal[next],
+    // a match match_length[length] + match_offset[offset].
+    struct PriceModel {
+        uint32_t literal_token = 0;
+        std::vector<uint32_t> literal;      // 256 entries
+        std::vector<uint32_t> match_length; // indexed by length, lookahead + 1 entries
+        std::vector<uint32_t> match_offset; // indexed by offset, window + 1 entries
+    };
+    // Shortest match the match finder reports; shorter repeats are emitted as literals
+    static constexpr size_t MIN_MATCH = 3;
+
+    // DEFLATE-style alphabets (HUF_LZV6, HLZ5): literal/length symbols 0-255 are literals,
+    // 256 ends the stream and 257-285 are match lengths; 30 distance symbols cover
+    // offsets 1-32768. Both carry extra bits for the position inside their range.
+    static constexpr unsigned END_OF_BLOCK = 256;
+    static constexpr unsigned LITLEN_SYMBOLS = 286;
+    static constexpr unsigned DIST_SYMBOLS = 30;
+    static constexpr size_t MAX_MATCH = 258;
+    static constexpr size_t MAX_OFFSET = 32768;
+    static constexpr uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static constexpr uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static constexpr uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                               257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                               8193, 12289, 16385, 24577};
+    static constexpr uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                               7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    struct SymbolCode {
+        uint16_t symbol;
+        uint8_t extra_bits;
+        uint16_t extra;
+    };
+    // length in [MIN_MATCH, MAX_MATCH] -> literal/length symbol; offset in [1, MAX_OFFSET] -> distance symbol
+    static SymbolCode lengthCode(size_t length);
+    static SymbolCode offsetCode(size_t offset);
+
+    // Hash chains of the greedy parser, kept between calls by a CompressContext. Stored
+    // positions are base + index and base advances past every input, so entries left
+    // by earlier inputs are recognised and skipped instead of clearing the tables.
+    struct MatchState {
+        std::vector<uint32_t> head;
+        std::vector<uint32_t> prev;
+        uint32_t base = 0;
+    };
+
+    // max_chain bounds how many earlier positions sharing the same hash are tried per byte.
+    // The first dict_size bytes of data are history only: matches may reach into them,
+    // but tokens start at data[dict_size].
+    static std::vector<Token> compress(const std::vector<uint8_t>& data, size_t window = 4096, size_t lookahead = 18, size_t max_chain = 32, size_t dict_size = 0);
+    // Same parse over data[0..n) into tokens (cleared first), reusing state's tables
+    static void compress(const uint8_t* data, size_t n, size_t window, size_t lookahead, size_t max_chain, size_t dict_size,
+                         MatchState& state, std::vector<Token>& tokens);
+    // Binary-tree match finder + price-based optimal parse (max_depth bounds the tree walk)
+    static std::vector<Token> compressOptimal(const std::vector<uint8_t>& data, const PriceModel& prices, size_t window = 4096, size_t lookahead = 18, size_t max_depth = 32, size_t dict_size = 0);
+    static std::vector<Token> compressOptimal(const uint8_t* data, size_t n, const PriceModel& prices, size_t window, size_t lookahead, size_t max_depth, size_t dict_size);
+    // Prices of the HUF_LZV6 symbol stream given the code length of each literal/length and distance symbol
+    static PriceModel symbolPrices(const std::vector<uint32_t>& litlen_bits, const std::vector<uint32_t>& dist_bits, size_t window = MAX_OFFSET, size_t lookahead = MAX_MATCH);
     static std::vector<uint8_t> decompress(const std::vector<Token>& tokens);
-    static std::vector<uint8_t> tokensToBytes(const std::vector<Token>& tokens);
-    static std::vector<Token> bytesToTokens(const std::vector<uint8_t>& bytes);
+    // Bytes copyMatch may write past the end of a match
+    static constexpr size_t COPY_SLACK = 16;
+    // Append the length bytes that start offset (>= 1) bytes before dst, 16 bytes at a
+    // time. dst needs room for length + COPY_SLACK bytes; the extra ones are scratch.
+    static void copyMatch(uint8_t* dst, size_t offset, size_t length);
 };
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "CompressionSettings.h"
+
+namespace huffman {
+
+// Receives output as soon as it is final; the bytes are only valid during the call
+using StreamSink = std::function<void(const uint8_t* data, size_t size)>;
+
+// Push-based compressor writing a framed HUF_STRM stream (ContainerFormat.h):
+// begin, any number of update calls, finish. Input is compressed one block at a
+// time (settings.block_size, or STREAM_DEFAULT_BLOCK_SIZE when 0), each primed
+// with the last 32 KiB before it, and every block goes to the sink as soon as it
+// is compressed. Memory stays at about one block whatever the stream length.
+// Throws HuffmanError.
+class StreamCompressor {
+public:
+    void begin(StreamSink sink, const CompressionSettings& settings = CompressionSettings());
+    void update(const uint8_t* data, size_t size);
+    // Compresses the last partial block and writes the end marker
+    void finish();
+
+    uint64_t totalIn() const { return total_in_; }
+    uint32_t checksum() const { return crc_; } // CRC32 of the input so far
+
+private:
+    void compressBlock();
+
+    StreamSink sink_;
+    CompressionSettings settings_;
+    size_t block_size_ = 0;
+    std::vector<uint8_t> window_; // dictionary (the input just before the block) + block
+    size_t dict_ = 0;
+    uint64_t total_in_ = 0;
+    uint32_t crc_ = 0;
+    bool active_ = false;
+};
+
+// Incremental decoder, fed compressed bytes in pieces of any size. HUF_STRM input
+// decodes frame by frame, holding one frame, its block and 32 KiB of history.
+// Other formats have no framing, so they are collected and decoded by finish().
+// Throws HuffmanError.
+class StreamDecompressor {
+public:
+    void begin(StreamSink sink);
+    void update(const uint8_t* data, size_t size);
+    // Decodes collected non-stream input; throws if a stream ended before its end marker
+    void finish();
+
+private:
+    enum class State { IDLE, MAGIC, FRAME_HEADER, FRAME, TRAILER, DONE, WHOLE };
+    // Handles the need_ bytes the current state was waiting for
+    void consume(const uint8_t* piece);
+
+    StreamSink sink_;
+    State state_ = State::IDLE;
+    size_t need_ = 0;
+    std::vector<uint8_t> pending_; // a piece split across update calls
+    std::vector<uint8_t> window_;  // last 32 KiB of output (LZ77 history) + the block being decoded
+    uint64_t total_out_ = 0;
+    uint32_t crc_ = 0;
+};
+
+} // namespace huffman
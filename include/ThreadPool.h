@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace huffman {
+
+// Fixed set of worker threads with one task deque per worker. A worker pops its
+// own deque from the back and, when that is empty, steals from the front of the
+// others. Tasks submitted from outside the pool are spread round-robin.
+class ThreadPool {
+public:
+    // threads = 0 uses hardware_concurrency() (at least one)
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process-wide pool shared by chunk compression, chunk decompression and folder work
+    static ThreadPool& shared();
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+    // Queue a task. Exceptions escaping a task are swallowed; callers report errors themselves.
+    void submit(std::function<void()> task);
+
+    // Runs body(i) for i in [0, n) on at most max_threads threads (0 = pool size + caller).
+    // The calling thread takes indices too, so nested calls from inside a task cannot
+    // deadlock. Returns once every started index is done; the first exception is rethrown.
+    template <typename Body>
+    void parallelFor(size_t n, unsigned max_threads, Body&& body);
+
+private:
+    struct Queue {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(unsigned index);
+    bool popTask(unsigned index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex sleep_mtx_;
+    std::condition_variable wake_;
+    size_t pending_ = 0; // queued tasks, guarded by sleep_mtx_
+    bool stop_ = false;
+    std::atomic<unsigned> next_queue_{0};
+};
+
+template <typename Body>
+void ThreadPool::parallelFor(size_t n, unsigned max_threads, Body&& body) {
+    if (n == 0) return;
+    // Shared with the helper tasks, which may start after this call has returned
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<unsigned> active{0};
+        std::atomic<bool> failed{false};
+        std::mutex mtx;
+        std::condition_variable idle;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+
+    auto run = [state, n, &body]() {
+        while (!state->failed.load()) {
+            size_t i = state->next.fetch_add(1);
+            if (i >= n) break;
+            try {
+                body(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mtx);
+                if (!state->error) state->error = std::current_exception();
+                state->failed = true;
+            }
+        }
+    };
+
+    unsigned threads = max_threads == 0 ? size() + 1 : max_threads;
+    size_t helpers = std::min<size_t>({n - 1, threads > 0 ? threads - 1 : 0, size()});
+    for (size_t h = 0; h < helpers; ++h) {
+        submit([state, run]() {
+            // Registering before taking an index lets the caller wait for every helper
+            // that can still touch body; late helpers find no index left and return.
+            state->active.fetch_add(1);
+            run();
+            if (state->active.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(state->mtx);
+                state->idle.notify_all();
+            }
+        });
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->idle.wait(lock, [&] { return state->active.load() == 0; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+} // namespace huffman
@@ -1,29 +1,44 @@
 #include "../include/BitReader.h"
 #include <vector>
 #include <cstdint>
+#include <algorithm>
+
+BitReader::BitReader(const uint8_t* data, size_t size)
+    : data_(data), size_(size), pos_(0), bitbuf_(0), bitcount_(0) {}
 
 BitReader::BitReader(const std::vector<uint8_t>& buffer)
-    : buffer_(buffer), byte_pos_(0), bit_pos_(0) {}
+    : BitReader(buffer.data(), buffer.size()) {}
+
+BitReader::BitReader(Source source, size_t buffer_size)
+    : data_(nullptr), size_(0), pos_(0), bitbuf_(0), bitcount_(0), source_(std::move(source)),
+      owned_(std::max<size_t>(buffer_size, 16)) {
+    data_ = owned_.data();
+}
+
+bool BitReader::fetch() {
+    const size_t left = size_ - pos_;
+    std::memmove(owned_.data(), data_ + pos_, left);
+    const size_t added = source_(owned_.data() + left, owned_.size() - left);
+    data_ = owned_.data();
+    pos_ = 0;
+    size_ = left + added;
+    return added > 0;
+}
 
 bool BitReader::readBit() {
-    if (byte_pos_ >= buffer_.size()) return false;
-    bool bit = (buffer_[byte_pos_] >> (7 - bit_pos_)) & 1;
-    bit_pos_++;
-    if (bit_pos_ == 8) {
-        bit_pos_ = 0;
-        byte_pos_++;
-    }
-    return bit;
+    return readBits(1) != 0;
 }
 
 uint64_t BitReader::readBits(unsigned count) {
-    uint64_t value = 0;
-    for (unsigned i = 0; i < count; ++i) {
-        value = (value << 1) | (readBit() ? 1 : 0);
+    if (count > 56) {
+        uint64_t high = readBits(count - 32);
+        return (high << 32) | readBits(32);
     }
+    uint64_t value = peek(count);
+    consume(count);
     return value;
 }
 
 bool BitReader::hasMoreBits() const {
-    return byte_pos_ < buffer_.size();
-}
\ No newline at end of file
+    return bitsRemaining() > 0;
+}
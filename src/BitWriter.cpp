@@ -1,39 +1,69 @@
 #include "../include/BitWriter.h"
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <ostream>
 
-BitWriter::BitWriter() : buffer_(), current_byte_(0), bit_pos_(0) {}
+BitWriter::BitWriter() : buffer_(), pos_(0), acc_(0), acc_bits_(0) {}
+
+BitWriter::BitWriter(size_t expected_bytes) : BitWriter() {
+    reserve(expected_bytes);
+}
+
+void BitWriter::reserve(size_t expected_bytes) {
+    if (buffer_.size() < pos_ + expected_bytes + 8) buffer_.resize(pos_ + expected_bytes + 8);
+}
+
+void BitWriter::clear() {
+    pos_ = 0;
+    acc_ = 0;
+    acc_bits_ = 0;
+}
+
+void BitWriter::grow() {
+    buffer_.resize(std::max<size_t>(buffer_.size() * 2, pos_ + 64));
+}
 
 void BitWriter::writeBit(bool bit) {
-    current_byte_ = (current_byte_ << 1) | (bit ? 1 : 0);
-    bit_pos_++;
-    if (bit_pos_ == 8) {
-        buffer_.push_back(current_byte_);
-        current_byte_ = 0;
-        bit_pos_ = 0;
-    }
+    writeBits(bit ? 1 : 0, 1);
 }
 
 void BitWriter::writeBits(uint64_t value, unsigned count) {
-    for (int i = count - 1; i >= 0; --i) {
-        writeBit((value >> i) & 1);
+    if (count == 0) return;
+    if (count > 56) {
+        writeBits(value >> 32, count - 32);
+        writeBits(value & 0xFFFFFFFFu, 32);
+        return;
     }
+    if (pos_ + 8 > buffer_.size()) grow();
+    value &= (uint64_t(1) << count) - 1;
+    acc_ |= value << (64 - acc_bits_ - count);
+    acc_bits_ += count;
+
+    // Store all 8 accumulator bytes big-endian; only the complete ones are kept
+#if (defined(__GNUC__) || defined(__clang__)) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t be = __builtin_bswap64(acc_);
+    std::memcpy(buffer_.data() + pos_, &be, sizeof(be));
+#else
+    for (int i = 0; i < 8; ++i) buffer_[pos_ + i] = static_cast<uint8_t>(acc_ >> (56 - 8 * i));
+#endif
+    unsigned bytes = acc_bits_ >> 3;
+    pos_ += bytes;
+    acc_ <<= bytes * 8;
+    acc_bits_ &= 7;
 }
 
 void BitWriter::flush() {
-    if (bit_pos_ > 0) {
-        buffer_.push_back(current_byte_ << (8 - bit_pos_));
-        current_byte_ = 0;
-        bit_pos_ = 0;
+    if (acc_bits_ > 0) {
+        if (pos_ + 1 > buffer_.size()) grow();
+        buffer_[pos_++] = static_cast<uint8_t>(acc_ >> 56);
+        acc_ = 0;
+        acc_bits_ = 0;
     }
 }
 
-const std::vector<uint8_t>& BitWriter::getBuffer() const {
-    return buffer_;
-}
-
 void BitWriter::writeToStream(std::ostream& os) {
     flush();
-    for (uint8_t b : buffer_) os.put(static_cast<char>(b));
+    os.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(pos_));
 }
@@ -60,7 +60,12 @@ uint32_t CRC32::calculate(const std::string& data) {
 }
 
 uint32_t CRC32::calculate(const uint8_t* data, size_t length) {
-    uint32_t crc = 0xFFFFFFFF;
+    return update(0, data, length);
+}
+
+uint32_t CRC32::update(uint32_t crc, const uint8_t* data, size_t length) {
+    // Undo the final inversion of the previous result to resume its state
+    crc ^= 0xFFFFFFFF;
     
     for (size_t i = 0; i < length; ++i) {
         uint8_t byte = data[i];
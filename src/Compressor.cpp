@@ -1,10 +1,12 @@
 #include "../include/LZ77.h"
 #include <fstream>
 #include <iostream>
-#include <thread>
-#include <future>
 #include <mutex>
-#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include "../include/Compressor.h"
@@ -12,83 +14,255 @@
 #include "../include/BitWriter.h"
 #include "../include/ErrorHandler.h"
 #include "../include/Checksum.h"
+#include "../include/ThreadPool.h"
+#include "../include/ContainerFormat.h"
+#include "../include/CodecContext.h"
+#include "../include/StreamCodec.h"
 
-// Helper: Split data into chunks
-static std::vector<std::vector<unsigned char>> splitChunks(const std::vector<unsigned char>& data, size_t chunkSize) {
-    std::vector<std::vector<unsigned char>> chunks;
-    size_t total = data.size();
-    for (size_t i = 0; i < total; i += chunkSize) {
-        size_t end = std::min(i + chunkSize, total);
-        chunks.emplace_back(data.begin() + i, data.begin() + end);
+// Append a jump table (byte size of every stream but the last, uint32_t LE) followed by the streams
+static void appendInterleavedStreams(std::vector<unsigned char>& out, BitWriter (&writers)[huffman::INTERLEAVED_STREAMS]) {
+    for (unsigned s = 0; s + 1 < huffman::INTERLEAVED_STREAMS; ++s) {
+        writers[s].flush();
+        uint32_t size = static_cast<uint32_t>(writers[s].size());
+        for (size_t b = 0; b < sizeof(size); ++b) out.push_back((size >> (8 * b)) & 0xFF);
     }
-    return chunks;
+    for (auto& writer : writers) {
+        writer.flush();
+        out.insert(out.end(), writer.data(), writer.data() + writer.size());
+    }
+}
+
+// LZ77 + Huffman encoding shared by HUF_LZV6 files and HLZ5 chunks. data[0..dict_size)
+// is match history only (a primed dictionary); tokens cover the rest. Leaves the
+// code lengths and the payload (jump table + interleaved streams, covered by the
+// CRC) in scratch.
+static void encodeHybridBlock(const uint8_t* data, size_t size, size_t dict_size, const huffman::CompressionSettings& settings,
+                              huffman::CompressScratch& scratch);
+
+// Compress one chunk into a self-contained blob: HLZ5 (LZ77 + Huffman) when
+// settings.chunk_lz77 is set, otherwise HUF4. input[0..dict_size) is the primed
+// tail of the previous chunk and only used by HLZ5.
+static std::vector<unsigned char> compressChunk(const std::vector<unsigned char>& input, size_t dict_size, const huffman::CompressionSettings& settings) {
+    if (settings.chunk_lz77) {
+        huffman::CompressScratch block;
+        encodeHybridBlock(input.data(), input.size(), dict_size, settings, block);
+        uint32_t crc = huffman::CRC32::calculate(block.payload);
+        std::vector<unsigned char> outbuf;
+        outbuf.reserve(4 + sizeof(uint64_t) + sizeof(uint32_t) + LZ77::LITLEN_SYMBOLS + LZ77::DIST_SYMBOLS + sizeof(crc) + block.payload.size());
+        // Header: magic + size + dictionary size + code lengths + CRC32 + jump table and streams
+        outbuf.insert(outbuf.end(), {'H','L','Z','5'});
+        uint64_t orig_size = input.size() - dict_size;
+        for (size_t b = 0; b < sizeof(orig_size); ++b) outbuf.push_back((orig_size >> (8 * b)) & 0xFF);
+        uint32_t dict = static_cast<uint32_t>(dict_size);
+        for (size_t b = 0; b < sizeof(dict); ++b) outbuf.push_back((dict >> (8 * b)) & 0xFF);
+        outbuf.insert(outbuf.end(), block.litlen_lens.begin(), block.litlen_lens.end());
+        outbuf.insert(outbuf.end(), block.dist_lens.begin(), block.dist_lens.end());
+        for (size_t b = 0; b < sizeof(crc); ++b) outbuf.push_back((crc >> (8 * b)) & 0xFF);
+        outbuf.insert(outbuf.end(), block.payload.begin(), block.payload.end());
+        return outbuf;
+    }
+    const std::vector<unsigned char>& chunkData = input;
+    HuffmanTree tree;
+    std::vector<uint64_t> counts(256, 0);
+    for (unsigned char c : chunkData) counts[c]++;
+    tree.build(counts, settings.max_code_length);
+    const HuffmanTree::CodeArray codes = tree.getCodeArray();
+    uint64_t total_bits = 0;
+    for (int s = 0; s < 256; ++s) total_bits += counts[s] * codes[s].length;
+    // Byte i goes to stream i % 4 so the decoder can run four independent readers
+    constexpr unsigned STREAMS = huffman::INTERLEAVED_STREAMS;
+    BitWriter writers[STREAMS];
+    for (auto& w : writers) w.reserve(static_cast<size_t>(total_bits / 8 / STREAMS + 1));
+    const size_t n = chunkData.size();
+    size_t pos = 0;
+    for (; pos + STREAMS <= n; pos += STREAMS) {
+        for (unsigned s = 0; s < STREAMS; ++s) {
+            const HuffmanTree::Code& c = codes[chunkData[pos + s]];
+            writers[s].writeBits(c.code, c.length);
+        }
+    }
+    for (; pos < n; ++pos) writers[pos % STREAMS].writeBits(codes[chunkData[pos]].code, codes[chunkData[pos]].length);
+    std::vector<unsigned char> buf;
+    buf.reserve(total_bits / 8 + 4 * STREAMS);
+    appendInterleavedStreams(buf, writers);
+    uint32_t crc = huffman::CRC32::calculate(buf);
+    std::vector<unsigned char> outbuf;
+    outbuf.reserve(4 + sizeof(uint64_t) + 256 + sizeof(crc) + buf.size());
+    // Write header: magic + size + code lengths + CRC32 + jump table and streams
+    outbuf.insert(outbuf.end(), {'H','U','F','4'});
+    // Write original (uncompressed) chunk size (uint64_t, little-endian)
+    uint64_t orig_size = chunkData.size();
+    for (size_t b = 0; b < sizeof(orig_size); ++b) {
+        outbuf.push_back((orig_size >> (8 * b)) & 0xFF);
+    }
+    for (int j = 0; j < 256; ++j) {
+        outbuf.push_back(codes[j].length);
+    }
+    for (size_t b = 0; b < sizeof(crc); ++b) {
+        outbuf.push_back((crc >> (8 * b)) & 0xFF);
+    }
+    outbuf.insert(outbuf.end(), buf.begin(), buf.end());
+    return outbuf;
+}
+
+void huffman::StreamCompressor::begin(StreamSink sink, const CompressionSettings& settings) {
+    sink_ = std::move(sink);
+    settings_ = settings;
+    settings_.chunk_lz77 = true;
+    block_size_ = settings.block_size == 0 ? STREAM_DEFAULT_BLOCK_SIZE : std::min(settings.block_size, STREAM_MAX_BLOCK_SIZE);
+    window_.clear();
+    window_.reserve(LZ77::MAX_OFFSET + block_size_);
+    dict_ = 0;
+    total_in_ = 0;
+    crc_ = 0;
+    active_ = true;
+    sink_(reinterpret_cast<const uint8_t*>(STREAM_MAGIC), STREAM_MAGIC_SIZE);
+}
+
+void huffman::StreamCompressor::update(const uint8_t* data, size_t size) {
+    if (!active_) throw HuffmanError(ErrorCode::INVALID_INPUT, "Stream compressor was not started");
+    crc_ = CRC32::update(crc_, data, size);
+    total_in_ += size;
+    while (size > 0) {
+        size_t n = std::min(size, dict_ + block_size_ - window_.size());
+        window_.insert(window_.end(), data, data + n);
+        data += n;
+        size -= n;
+        if (window_.size() == dict_ + block_size_) compressBlock();
+    }
+}
+
+void huffman::StreamCompressor::finish() {
+    if (!active_) throw HuffmanError(ErrorCode::INVALID_INPUT, "Stream compressor was not started");
+    if (window_.size() > dict_) compressBlock();
+    std::vector<unsigned char> trailer;
+    appendLittleEndian(trailer, 0, STREAM_FRAME_HEADER_SIZE);
+    appendLittleEndian(trailer, total_in_, 8);
+    appendLittleEndian(trailer, crc_, 4);
+    active_ = false;
+    sink_(trailer.data(), trailer.size());
+}
+
+// Emits window_[dict_ ..) as one frame and keeps the last 32 KiB as the next dictionary
+void huffman::StreamCompressor::compressBlock() {
+    std::vector<unsigned char> blob = compressChunk(window_, dict_, settings_);
+    std::vector<unsigned char> header;
+    appendLittleEndian(header, blob.size(), STREAM_FRAME_HEADER_SIZE);
+    sink_(header.data(), header.size());
+    sink_(blob.data(), blob.size());
+    dict_ = std::min<size_t>(window_.size(), LZ77::MAX_OFFSET);
+    window_.erase(window_.begin(), window_.end() - dict_);
+}
+
+// Chunks between reading and writing. Chunk i lives in slots[i % slots.size()]
+// until it is written, so memory stays at a fixed number of chunks whatever the
+// file size. Shared with pool tasks, which may outlive compressParallel on error.
+struct ChunkPipeline {
+    struct Slot {
+        std::vector<unsigned char> input; // primed dictionary followed by the chunk
+        size_t dict = 0;
+        std::vector<unsigned char> output;
+        uint32_t checksum = 0;            // CRC32 of the chunk itself (without the dictionary)
+        std::exception_ptr error;
+        bool done = false;
+    };
+    huffman::CompressionSettings settings;
+    std::vector<Slot> slots;
+    std::mutex mtx;
+    std::condition_variable cv;
+    size_t read = 0;          // chunks read so far
+    size_t next = 0;          // next chunk to compress
+    unsigned running = 0;     // pool tasks submitted and not yet finished
+    bool abort = false;
+};
+
+// Claims the next read chunk under the lock; false if none is waiting
+static bool claimChunk(ChunkPipeline& p, size_t& index) {
+    if (p.abort || p.next >= p.read) return false;
+    index = p.next++;
+    return true;
+}
+
+static void compressClaimedChunk(ChunkPipeline& p, size_t index) {
+    ChunkPipeline::Slot& slot = p.slots[index % p.slots.size()];
+    try {
+        slot.output = compressChunk(slot.input, slot.dict, p.settings);
+        slot.checksum = huffman::CRC32::calculate(slot.input.data() + slot.dict, slot.input.size() - slot.dict);
+    } catch (...) {
+        slot.error = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(p.mtx);
+        slot.done = true;
+    }
+    p.cv.notify_all();
 }
 
-// Parallel compress function
+// Parallel compress function: read -> compress on the shared pool -> write in order.
+// At most slots.size() chunks are held at once. Writes a seekable HUF_PAR2
+// container whose chunk index follows the last chunk.
 bool Compressor::compressParallel(const std::string& inPath, const std::string& outPath, const huffman::CompressionSettings& settings, size_t chunkSize) {
     try {
-        std::ifstream in(inPath, std::ios::binary);
-    if (!in) throw huffman::HuffmanError(huffman::ErrorCode::FILE_NOT_FOUND, inPath);
-        std::vector<unsigned char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-    if (in.bad()) throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, inPath);
-        if (data.empty()) return compressInternal(inPath, outPath, settings);
-
-        // Split into chunks
-        auto chunks = splitChunks(data, chunkSize);
-        size_t numChunks = chunks.size();
-        std::vector<std::vector<unsigned char>> compressedChunks(numChunks);
-        std::vector<size_t> chunkSizes(numChunks);
-
-        // Compress each chunk in parallel
-        std::vector<std::future<void>> futures;
-        std::mutex mtx;
-        std::atomic<size_t> completedChunks{0};
-        for (size_t i = 0; i < numChunks; ++i) {
-            futures.push_back(std::async(std::launch::async, [&, i]() {
-                // Use a local Compressor for each chunk
-                Compressor localCompressor;
-                std::string tempOut = "chunk_" + std::to_string(i) + ".huf";
-                // Compress chunk to buffer (not file)
-                std::vector<unsigned char>& chunkData = chunks[i];
-                HuffmanTree tree;
-                std::unordered_map<unsigned char, uint64_t> freq;
-                for (unsigned char c : chunkData) freq[c]++;
-                tree.build(freq);
-                auto canonical_codes = tree.getCanonicalCodes();
-                BitWriter writer;
-                for (unsigned char c : chunkData) {
-                    const std::string& bits = canonical_codes[c];
-                    for (char b : bits) writer.writeBit(b == '1');
-                }
-                writer.flush();
-                const auto& buf = writer.getBuffer();
-                uint32_t crc = huffman::CRC32::calculate(buf);
-                std::vector<unsigned char> outbuf;
-                // Write header: magic + code lengths + CRC32 + compressed data
-                outbuf.insert(outbuf.end(), {'H','U','F','2'});
-                // Write original (uncompressed) chunk size (uint64_t, little-endian)
-                uint64_t orig_size = chunkData.size();
-                for (size_t b = 0; b < sizeof(orig_size); ++b) {
-                    outbuf.push_back((orig_size >> (8 * b)) & 0xFF);
-                }
-                HuffmanTree::CodeLenTable code_lens = tree.getCodeLengths();
-                for (int j = 0; j < 256; ++j) {
-                    unsigned char len = 0;
-                    auto it = code_lens.find((unsigned char)j);
-                    if (it != code_lens.end()) len = (unsigned char)it->second;
-                    outbuf.push_back(len);
-                }
-                for (size_t b = 0; b < sizeof(crc); ++b) {
-                    outbuf.push_back((crc >> (8 * b)) & 0xFF);
+        std::ifstream in(inPath, std::ios::binary | std::ios::ate);
+        if (!in) throw huffman::HuffmanError(huffman::ErrorCode::FILE_NOT_FOUND, inPath);
+        const uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+        in.seekg(0, std::ios::beg);
+        if (in.bad()) throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, inPath);
+        if (chunkSize == 0) throw huffman::HuffmanError(huffman::ErrorCode::INVALID_INPUT, "Chunk size must be positive");
+        const uint64_t numChunks = (fileSize + chunkSize - 1) / chunkSize;
+
+        std::ofstream out(outPath, std::ios::binary);
+        if (!out) throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
+        try {
+            // Main header: magic only; chunk offsets and sizes go to the trailing index
+            out.write(huffman::PAR2_MAGIC, huffman::PAR2_MAGIC_SIZE);
+            std::vector<huffman::ChunkIndexEntry> chunkIndex(numChunks);
+            uint64_t compressedPos = huffman::PAR2_MAGIC_SIZE;
+
+            huffman::ThreadPool& pool = huffman::ThreadPool::shared();
+            const unsigned cap = settings.threads == 0 ? pool.size() + 1 : settings.threads;
+            const unsigned helpers = std::min(pool.size(), cap > 0 ? cap - 1 : 0u);
+            auto pipeline = std::make_shared<ChunkPipeline>();
+            pipeline->settings = settings;
+            // Two chunks per thread keep every worker busy while the writer drains
+            pipeline->slots.resize(std::min<uint64_t>(numChunks, 2 * (helpers + 1)));
+            struct Abort {
+                ChunkPipeline& p;
+                ~Abort() {
+                    std::lock_guard<std::mutex> lock(p.mtx);
+                    p.abort = true;
                 }
-                outbuf.insert(outbuf.end(), buf.begin(), buf.end());
-                {
-                    std::lock_guard<std::mutex> lock(mtx);
-                    compressedChunks[i] = std::move(outbuf);
-                    chunkSizes[i] = compressedChunks[i].size();
+            } stopOnExit{*pipeline};
+
+            // Waits for chunk k (compressing waiting chunks meanwhile), then appends it to the output
+            auto writeChunk = [&](size_t k) {
+                ChunkPipeline::Slot& slot = pipeline->slots[k % pipeline->slots.size()];
+                while (true) {
+                    size_t index;
+                    {
+                        std::unique_lock<std::mutex> lock(pipeline->mtx);
+                        if (slot.done) break;
+                        if (!claimChunk(*pipeline, index)) {
+                            pipeline->cv.wait(lock, [&] { return slot.done; });
+                            break;
+                        }
+                    }
+                    compressClaimedChunk(*pipeline, index);
                 }
+                if (slot.error) std::rethrow_exception(slot.error);
+                out.write(reinterpret_cast<const char*>(slot.output.data()), slot.output.size());
+                if (out.bad()) throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
+                huffman::ChunkIndexEntry& entry = chunkIndex[k];
+                entry.compressed_offset = compressedPos;
+                entry.compressed_size = slot.output.size();
+                entry.original_offset = static_cast<uint64_t>(k) * chunkSize;
+                entry.original_size = slot.input.size() - slot.dict;
+                entry.checksum = slot.checksum;
+                entry.dict_size = static_cast<uint32_t>(slot.dict);
+                compressedPos += slot.output.size();
+                slot.output = std::vector<unsigned char>();
                 // Progress feedback
-                size_t done = ++completedChunks;
+                size_t done = k + 1;
                 if (settings.progress) {
                     // Show percentage progress bar
                     int percent = static_cast<int>((done * 100) / numChunks);
@@ -103,28 +277,80 @@ bool Compressor::compressParallel(const std::string& inPath, const std::string&
                     std::cout << "] " << done << "/" << numChunks << std::flush;
                     if (done == numChunks) std::cout << std::endl;
                 } else if (settings.verbose) {
-                    std::cout << "Chunk " << i << " compressed (" << chunkSizes[i] << " bytes)\n";
+                    std::cout << "Chunk " << k << " compressed (" << chunkIndex[k].compressed_size << " bytes)\n";
                 }
-            }));
-        }
-        for (auto& f : futures) f.get();
+            };
 
-        // Write all chunks to output file
-        std::ofstream out(outPath, std::ios::binary);
-    if (!out) throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
-        // Main header: magic + numChunks + chunkSizes[]
-        out.write("HUF_PAR", 7);
-        uint32_t nChunks = static_cast<uint32_t>(numChunks);
-        out.write(reinterpret_cast<const char*>(&nChunks), sizeof(nChunks));
-        for (size_t i = 0; i < numChunks; ++i) {
-            uint32_t sz = static_cast<uint32_t>(chunkSizes[i]);
-            out.write(reinterpret_cast<const char*>(&sz), sizeof(sz));
-        }
-        // Write all compressed chunks
-        for (const auto& buf : compressedChunks) {
-            out.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+            const size_t window = pipeline->slots.size();
+            // Hybrid chunks may start with the tail of the previous chunk as LZ77 history,
+            // except every DICTIONARY_RESTART_CHUNKS-th, where range reads can start
+            const size_t dictLimit = settings.chunk_lz77 ? std::min<size_t>(settings.chunk_dictionary, LZ77::MAX_OFFSET) : 0;
+            std::vector<unsigned char> tail;
+            for (size_t i = 0; i < numChunks; ++i) {
+                // The slot is free once the chunk that used it before has been written
+                if (i >= window) writeChunk(i - window);
+                ChunkPipeline::Slot& slot = pipeline->slots[i % window];
+                size_t len = static_cast<size_t>(std::min<uint64_t>(chunkSize, fileSize - i * chunkSize));
+                if (i % huffman::DICTIONARY_RESTART_CHUNKS == 0) tail.clear();
+                slot.dict = tail.size();
+                slot.input.assign(tail.begin(), tail.end());
+                slot.input.resize(slot.dict + len);
+                in.read(reinterpret_cast<char*>(slot.input.data() + slot.dict), static_cast<std::streamsize>(len));
+                if (static_cast<size_t>(in.gcount()) != len) {
+                    throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, inPath);
+                }
+                if (dictLimit > 0) {
+                    size_t keep = std::min(dictLimit, slot.input.size());
+                    tail.assign(slot.input.end() - keep, slot.input.end());
+                }
+                bool submit = false;
+                {
+                    std::lock_guard<std::mutex> lock(pipeline->mtx);
+                    slot.done = false;
+                    slot.error = nullptr;
+                    ++pipeline->read;
+                    if (pipeline->running < helpers) {
+                        ++pipeline->running;
+                        submit = true;
+                    }
+                }
+                if (submit) {
+                    pool.submit([pipeline]() {
+                        ChunkPipeline& p = *pipeline;
+                        while (true) {
+                            size_t index;
+                            {
+                                std::lock_guard<std::mutex> lock(p.mtx);
+                                if (!claimChunk(p, index)) {
+                                    --p.running;
+                                    return;
+                                }
+                            }
+                            compressClaimedChunk(p, index);
+                        }
+                    });
+                }
+            }
+            for (size_t k = numChunks > window ? numChunks - window : 0; k < numChunks; ++k) writeChunk(k);
+
+            // Trailing index + footer
+            std::vector<unsigned char> tailBytes;
+            tailBytes.reserve(chunkIndex.size() * huffman::CHUNK_INDEX_ENTRY_SIZE + huffman::PAR2_FOOTER_SIZE);
+            for (const auto& entry : chunkIndex) huffman::appendIndexEntry(tailBytes, entry);
+            uint32_t indexCrc = huffman::CRC32::calculate(tailBytes);
+            huffman::appendLittleEndian(tailBytes, compressedPos, 8);
+            huffman::appendLittleEndian(tailBytes, numChunks, 8);
+            huffman::appendLittleEndian(tailBytes, indexCrc, 4);
+            tailBytes.insert(tailBytes.end(), huffman::PAR2_FOOTER_MAGIC, huffman::PAR2_FOOTER_MAGIC + 4);
+            out.write(reinterpret_cast<const char*>(tailBytes.data()), tailBytes.size());
+            out.flush();
+            if (out.bad()) throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
+        } catch (...) {
+            // Do not leave a container without its index behind
+            out.close();
+            std::remove(outPath.c_str());
+            throw;
         }
-    if (out.bad()) throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
         return true;
     } catch (const huffman::HuffmanError& e) {
         std::cerr << "Parallel compression error: " << e.what() << std::endl;
@@ -139,11 +365,104 @@ bool Compressor::compressParallel(const std::string& inPath, const std::string&
 #include "../include/BitWriter.h"
 #include "../include/ErrorHandler.h"
 #include "../include/Checksum.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <unordered_map>
 #include <vector>
 
+// Literal/length and distance histograms of a token stream, including its end-of-block symbol
+static void countTokenSymbols(const std::vector<LZ77::Token>& tokens, std::vector<uint64_t>& litlen_freq, std::vector<uint64_t>& dist_freq) {
+    litlen_freq.assign(LZ77::LITLEN_SYMBOLS, 0);
+    dist_freq.assign(LZ77::DIST_SYMBOLS, 0);
+    for (const auto& t : tokens) {
+        if (t.length > 0) {
+            litlen_freq[LZ77::lengthCode(t.length).symbol]++;
+            dist_freq[LZ77::offsetCode(t.offset).symbol]++;
+        } else {
+            litlen_freq[t.next]++;
+        }
+    }
+    litlen_freq[LZ77::END_OF_BLOCK]++;
+}
+
+// Bit cost per symbol; symbols without a code cost one bit more than the longest code
+static std::vector<uint32_t> symbolBits(const std::vector<uint8_t>& lengths) {
+    uint32_t max_len = 0;
+    for (uint8_t len : lengths) max_len = std::max<uint32_t>(max_len, len);
+    std::vector<uint32_t> bits(lengths.size(), max_len + 1);
+    for (size_t i = 0; i < lengths.size(); ++i) {
+        if (lengths[i]) bits[i] = lengths[i];
+    }
+    return bits;
+}
+
+static void encodeHybridBlock(const uint8_t* data, size_t size, size_t dict_size, const huffman::CompressionSettings& settings,
+                              huffman::CompressScratch& scratch) {
+    // LZ77 compression
+    constexpr size_t LZ_WINDOW = LZ77::MAX_OFFSET;
+    constexpr size_t LZ_LOOKAHEAD = LZ77::MAX_MATCH;
+    std::vector<LZ77::Token>& lz_tokens = scratch.tokens;
+    LZ77::compress(data, size, LZ_WINDOW, LZ_LOOKAHEAD, settings.max_chain, dict_size, scratch.matches, lz_tokens);
+    std::vector<uint64_t>& litlen_freq = scratch.litlen_freq;
+    std::vector<uint64_t>& dist_freq = scratch.dist_freq;
+
+    // Best mode: re-parse optimally, pricing each token with the Huffman
+    // code lengths of the previous pass's symbols
+    if (settings.mode == huffman::CompressionSettings::BEST) {
+        unsigned passes = std::max(1u, settings.extra_passes);
+        for (unsigned pass = 0; pass < passes; ++pass) {
+            countTokenSymbols(lz_tokens, litlen_freq, dist_freq);
+            auto prices = LZ77::symbolPrices(symbolBits(HuffmanTree::buildLengths(litlen_freq, settings.max_code_length)),
+                                             symbolBits(HuffmanTree::buildLengths(dist_freq, settings.max_code_length)),
+                                             LZ_WINDOW, LZ_LOOKAHEAD);
+            lz_tokens = LZ77::compressOptimal(data, size, prices, LZ_WINDOW, LZ_LOOKAHEAD, settings.max_chain, dict_size);
+        }
+    }
+
+    // Literal/length and distance alphabets get separate Huffman codes
+    countTokenSymbols(lz_tokens, litlen_freq, dist_freq);
+    scratch.litlen_lens = HuffmanTree::buildLengths(litlen_freq, settings.max_code_length);
+    scratch.dist_lens = HuffmanTree::buildLengths(dist_freq, settings.max_code_length);
+    scratch.litlen_codes = HuffmanTree::canonicalCodes(scratch.litlen_lens);
+    scratch.dist_codes = HuffmanTree::canonicalCodes(scratch.dist_lens);
+    const std::vector<uint8_t>& litlen_lens = scratch.litlen_lens;
+    const std::vector<uint8_t>& dist_lens = scratch.dist_lens;
+    const std::vector<uint32_t>& litlen_codes = scratch.litlen_codes;
+    const std::vector<uint32_t>& dist_codes = scratch.dist_codes;
+
+    // Huffman encode LZ77 tokens: a literal, or length symbol + extra, distance symbol + extra
+    // Token i goes to stream i % 4; END_OF_BLOCK follows in the next stream in turn
+    // Size the output from the histograms; 18 bits covers the largest length + distance extras
+    constexpr unsigned STREAMS = huffman::INTERLEAVED_STREAMS;
+    uint64_t total_bits = 0;
+    for (size_t s = 0; s < litlen_freq.size(); ++s) total_bits += litlen_freq[s] * litlen_lens[s];
+    for (size_t s = 0; s < dist_freq.size(); ++s) total_bits += dist_freq[s] * (dist_lens[s] + 18);
+    BitWriter (&writers)[STREAMS] = scratch.writers;
+    for (auto& w : writers) {
+        w.clear();
+        w.reserve(static_cast<size_t>(total_bits / 8 / STREAMS + 1));
+    }
+    for (size_t i = 0; i < lz_tokens.size(); ++i) {
+        const auto& t = lz_tokens[i];
+        BitWriter& writer = writers[i % STREAMS];
+        if (t.length > 0) {
+            LZ77::SymbolCode lc = LZ77::lengthCode(t.length);
+            writer.writeBits(litlen_codes[lc.symbol], litlen_lens[lc.symbol]);
+            writer.writeBits(lc.extra, lc.extra_bits);
+            LZ77::SymbolCode dc = LZ77::offsetCode(t.offset);
+            writer.writeBits(dist_codes[dc.symbol], dist_lens[dc.symbol]);
+            writer.writeBits(dc.extra, dc.extra_bits);
+        } else {
+            writer.writeBits(litlen_codes[t.next], litlen_lens[t.next]);
+        }
+    }
+    writers[lz_tokens.size() % STREAMS].writeBits(litlen_codes[LZ77::END_OF_BLOCK], litlen_lens[LZ77::END_OF_BLOCK]);
+    scratch.payload.clear();
+    scratch.payload.reserve(total_bits / 8 + 4 * STREAMS);
+    appendInterleavedStreams(scratch.payload, writers);
+}
+
 bool Compressor::compress(const std::string& inPath, const std::string& outPath) {
     return compress(inPath, outPath, huffman::make_settings_from_level(5));
 }
@@ -152,9 +471,122 @@ bool Compressor::compress(const std::string& inPath, const std::string& outPath,
     return compressInternal(inPath, outPath, settings);
 }
 
+// HUF_LZV6 header (ContainerFormat.h): magic, original size and CRC32, literal/length
+// and distance code lengths, CRC32 of the payload
+static const size_t IMAGE_HEADER_SIZE = huffman::LZV6_MAGIC_SIZE + huffman::LZV6_SIZE_FIELDS +
+                                       LZ77::LITLEN_SYMBOLS + LZ77::DIST_SYMBOLS + sizeof(uint32_t);
+// Image of empty input: magic, size 0 and the CRC32 of nothing
+static const size_t EMPTY_IMAGE_SIZE = huffman::LZV6_MAGIC_SIZE + huffman::LZV6_SIZE_FIELDS;
+
+// Encode data[0..size) into block and return the size of its file image
+static size_t encodeImage(const uint8_t* data, size_t size, const huffman::CompressionSettings& settings,
+                          huffman::CompressScratch& block) {
+    if (size == 0) return EMPTY_IMAGE_SIZE;
+
+    encodeHybridBlock(data, size, 0, settings, block);
+
+    if (settings.verbose) {
+        size_t used = 0;
+        for (uint8_t len : block.litlen_lens) used += len > 0;
+        for (uint8_t len : block.dist_lens) used += len > 0;
+        std::cout << "Hybrid compression (LZ77 + Huffman)\n";
+        std::cout << "Input size: " << size << " bytes\n";
+        std::cout << "LZ77 tokens: " << block.tokens.size() << "\n";
+        std::cout << "Unique symbols: " << used << std::endl;
+    }
+    return IMAGE_HEADER_SIZE + block.payload.size();
+}
+
+// Write the image encodeImage sized for data[0..size) to out, which holds at least that many bytes
+static void writeImage(const uint8_t* data, size_t size, const huffman::CompressScratch& block, unsigned char* out) {
+    // Header: magic, then the original size and its CRC32 so a decoder can allocate once and verify
+    out = std::copy(huffman::LZV6_MAGIC, huffman::LZV6_MAGIC + huffman::LZV6_MAGIC_SIZE, out);
+    huffman::storeLittleEndian(out, size, 8);
+    huffman::storeLittleEndian(out + 8, huffman::CRC32::calculate(data, size), 4);
+    out += huffman::LZV6_SIZE_FIELDS;
+    if (size == 0) return;
+    // Literal/length and distance code lengths
+    uint32_t crc = huffman::CRC32::calculate(block.payload);
+    out = std::copy(block.litlen_lens.begin(), block.litlen_lens.end(), out);
+    out = std::copy(block.dist_lens.begin(), block.dist_lens.end(), out);
+    // CRC32 of the compressed data, then the data itself
+    std::memcpy(out, &crc, sizeof(crc));
+    out += sizeof(crc);
+    std::copy(block.payload.begin(), block.payload.end(), out);
+}
+
+// A bound on the total, not on single codes (those reach max_code_length bits).
+// A fixed code of ceil(log2(symbols used)) bits, at most 9 for literal/length
+// symbols and 5 for distances, is a valid length-limited code, so the optimal
+// one costs no more in total over the same histogram. Under the fixed code a
+// match of L >= 3 bytes takes at most 27 + extra length bits <= 9 * L, so the
+// streams need at most 9 bits per input byte in total, plus END_OF_BLOCK and one
+// byte of padding per stream.
+size_t huffman::compressBound(size_t size) {
+    if (size == 0) return EMPTY_IMAGE_SIZE;
+    return IMAGE_HEADER_SIZE + 4 * (INTERLEAVED_STREAMS - 1) + size + (size + 16) / 8 + INTERLEAVED_STREAMS;
+}
+
+void huffman::CompressContext::compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    out.resize(encodeImage(data, size, settings_, scratch_));
+    writeImage(data, size, scratch_, out.data());
+}
+
+size_t huffman::CompressContext::compressInto(const uint8_t* data, size_t size, uint8_t* dst, size_t capacity) {
+    size_t image_size = encodeImage(data, size, settings_, scratch_);
+    if (image_size > capacity) {
+        throw HuffmanError(ErrorCode::INVALID_INPUT, "Output buffer too small for the compressed data");
+    }
+    writeImage(data, size, scratch_, dst);
+    return image_size;
+}
+
+static void reportCompressionError(const huffman::HuffmanError& e) {
+    std::cerr << "Compression error: " << e.what() << std::endl;
+    switch (e.getCode()) {
+        case huffman::ErrorCode::FILE_NOT_FOUND:
+            std::cerr << "  Suggestion: Check the input file path and ensure the file exists." << std::endl;
+            break;
+        case huffman::ErrorCode::FILE_READ_ERROR:
+        case huffman::ErrorCode::FILE_WRITE_ERROR:
+            std::cerr << "  Suggestion: Check file permissions and disk space." << std::endl;
+            break;
+        case huffman::ErrorCode::INVALID_MAGIC:
+        case huffman::ErrorCode::CORRUPTED_HEADER:
+            std::cerr << "  Suggestion: The file may not be a valid Huffman-compressed file or is corrupted." << std::endl;
+            break;
+        case huffman::ErrorCode::COMPRESSION_FAILED:
+            std::cerr << "  Suggestion: Try running with verbose mode for more details." << std::endl;
+            break;
+        case huffman::ErrorCode::INVALID_INPUT:
+            std::cerr << "  Suggestion: Check input arguments and file format." << std::endl;
+            break;
+        case huffman::ErrorCode::MEMORY_ERROR:
+            std::cerr << "  Suggestion: Not enough memory. Try smaller files or close other applications." << std::endl;
+            break;
+        default:
+            break;
+    }
+}
+
+bool Compressor::compress(const std::vector<unsigned char>& input, std::vector<unsigned char>& output, const huffman::CompressionSettings& settings) {
+    try {
+        huffman::CompressContext context(settings);
+        context.compress(input, output);
+        return true;
+    } catch (const huffman::HuffmanError& e) {
+        reportCompressionError(e);
+        return false;
+    } catch (const std::exception& e) {
+        std::cerr << "Unexpected error during compression: " << e.what() << std::endl;
+        std::cerr << "  Suggestion: Try running with verbose mode or check your input files." << std::endl;
+        return false;
+    }
+}
+
+// File wrapper around CompressContext
 bool Compressor::compressInternal(const std::string& inPath, const std::string& outPath, const huffman::CompressionSettings& settings) {
     try {
-        constexpr size_t CHUNK_SIZE = 1024 * 1024; // 1MB
         std::ifstream in(inPath, std::ios::binary);
         if (!in) {
             throw huffman::HuffmanError(huffman::ErrorCode::FILE_NOT_FOUND, inPath);
@@ -162,106 +594,30 @@ bool Compressor::compressInternal(const std::string& inPath, const std::string&
 
         // Read input file into buffer
         std::vector<uint8_t> input_data;
-        in.clear();
         in.seekg(0, std::ios::end);
         std::streamsize file_size = in.tellg();
         in.seekg(0, std::ios::beg);
         input_data.resize(file_size);
         in.read(reinterpret_cast<char*>(input_data.data()), file_size);
-        if (input_data.empty()) {
-            std::ofstream out(outPath, std::ios::binary);
-            if (!out) {
-                throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
-            }
-            out.write("HUF1", 4);
-            uint16_t table_size = 0;
-            out.write(reinterpret_cast<const char*>(&table_size), sizeof(table_size));
-            return true;
+        if (in.gcount() != file_size) {
+            throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, inPath);
         }
 
-        // LZ77 compression
-        auto lz_tokens = LZ77::compress(input_data);
-        auto lz_bytes = LZ77::tokensToBytes(lz_tokens);
-
-        // Count frequencies for Huffman
-        std::unordered_map<unsigned char, uint64_t> freq;
-        for (unsigned char c : lz_bytes) freq[c]++;
+        std::vector<unsigned char> output;
+        huffman::CompressContext context(settings);
+        context.compress(input_data, output);
 
-        if (settings.verbose) {
-            std::cout << "Hybrid compression (LZ77 + Huffman)\n";
-            std::cout << "Input size: " << input_data.size() << " bytes\n";
-            std::cout << "LZ77 output size: " << lz_bytes.size() << " bytes\n";
-            std::cout << "Unique symbols: " << freq.size() << std::endl;
-        }
-
-        // Build Huffman tree and code table
-        HuffmanTree tree;
-        tree.build(freq);
-        auto canonical_codes = tree.getCanonicalCodes();
-
-        // Write to output file
         std::ofstream out(outPath, std::ios::binary);
         if (!out) {
             throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
         }
-
-        // Write header: magic + code lengths for all 256 symbols
-        out.write("HUF_LZ77", 8); // new magic for hybrid
-        HuffmanTree::CodeLenTable code_lens = tree.getCodeLengths();
-        for (int i = 0; i < 256; ++i) {
-            unsigned char len = 0;
-            auto it = code_lens.find((unsigned char)i);
-            if (it != code_lens.end()) len = (unsigned char)it->second;
-            out.put(len);
-        }
-
-        // Huffman encode LZ77 bytes
-        BitWriter writer;
-        for (unsigned char c : lz_bytes) {
-            const std::string& bits = canonical_codes[c];
-            for (char b : bits) writer.writeBit(b == '1');
-        }
-        writer.flush();
-        const auto& buf = writer.getBuffer();
-
-        // Calculate CRC32 of compressed data
-        uint32_t crc = huffman::CRC32::calculate(buf);
-        out.write(reinterpret_cast<const char*>(&crc), sizeof(crc));
-
-        // Write compressed data
-        out.write(reinterpret_cast<const char*>(buf.data()), buf.size());
-
+        out.write(reinterpret_cast<const char*>(output.data()), output.size());
         if (out.bad()) {
             throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
         }
-
         return true;
     } catch (const huffman::HuffmanError& e) {
-        std::cerr << "Compression error: " << e.what() << std::endl;
-        switch (e.getCode()) {
-            case huffman::ErrorCode::FILE_NOT_FOUND:
-                std::cerr << "  Suggestion: Check the input file path and ensure the file exists." << std::endl;
-                break;
-            case huffman::ErrorCode::FILE_READ_ERROR:
-            case huffman::ErrorCode::FILE_WRITE_ERROR:
-                std::cerr << "  Suggestion: Check file permissions and disk space." << std::endl;
-                break;
-            case huffman::ErrorCode::INVALID_MAGIC:
-            case huffman::ErrorCode::CORRUPTED_HEADER:
-                std::cerr << "  Suggestion: The file may not be a valid Huffman-compressed file or is corrupted." << std::endl;
-                break;
-            case huffman::ErrorCode::COMPRESSION_FAILED:
-                std::cerr << "  Suggestion: Try running with verbose mode for more details." << std::endl;
-                break;
-            case huffman::ErrorCode::INVALID_INPUT:
-                std::cerr << "  Suggestion: Check input arguments and file format." << std::endl;
-                break;
-            case huffman::ErrorCode::MEMORY_ERROR:
-                std::cerr << "  Suggestion: Not enough memory. Try smaller files or close other applications." << std::endl;
-                break;
-            default:
-                break;
-        }
+        reportCompressionError(e);
         return false;
     } catch (const std::exception& e) {
         std::cerr << "Unexpected error during compression: " << e.what() << std::endl;
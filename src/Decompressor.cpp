@@ -1,334 +1,1418 @@
 #include "../include/HuffmanTree.h"
 #include "../include/BitReader.h"
+#include "../include/HuffmanDecoder.h"
+#include "../include/ThreadPool.h"
 #include "../include/ErrorHandler.h"
 #include "../include/Checksum.h"
 #include "../include/Decompressor.h"
+#include "../include/CompressionSettings.h"
+#include "../include/ContainerFormat.h"
+#include "../include/CodecContext.h"
+#include "../include/StreamCodec.h"
 #include <string>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <iostream>
-#include <unordered_map>
+#include <mutex>
 #include <vector>
 
 #include "../include/LZ77.h"
 
-// Helper: convert int to bitstring of given length
-static std::string bitstring(int code, int len) {
-    std::string s;
-    for (int i = len - 1; i >= 0; --i) s += ((code >> i) & 1) ? '1' : '0';
-    return s;
-}
-#include <algorithm>
-#include <fstream>
-#include <iostream>
-#include <unordered_map>
-#include <vector>
+constexpr unsigned STREAMS = huffman::INTERLEAVED_STREAMS;
+// Jump table at the start of an interleaved payload: u32 LE sizes of all streams but the last
+constexpr size_t JUMP_TABLE_SIZE = 4 * (STREAMS - 1);
 
-bool Decompressor::decompress(const std::string& inPath, const std::string& outPath) {
-    try {
-        // Read compressed file
-        std::ifstream in(inPath, std::ios::binary);
-        if (!in) {
-            throw huffman::HuffmanError(huffman::ErrorCode::FILE_NOT_FOUND, inPath);
+// Sizes of the streams of an interleaved payload of payload_size bytes that starts with table
+static void interleavedStreamSizes(const unsigned char* table, uint64_t payload_size, uint64_t (&sizes)[STREAMS]) {
+    if (payload_size < JUMP_TABLE_SIZE) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Stream jump table truncated");
+    }
+    uint64_t left = payload_size - JUMP_TABLE_SIZE;
+    for (unsigned s = 0; s + 1 < STREAMS; ++s) {
+        uint32_t stored = 0;
+        for (size_t b = 0; b < sizeof(stored); ++b) stored |= (uint32_t)table[4 * s + b] << (8 * b);
+        if (stored > left) {
+            throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Stream size exceeds payload");
         }
+        sizes[s] = stored;
+        left -= stored;
+    }
+    sizes[STREAMS - 1] = left;
+}
 
-        // Read magic (up to 8 bytes)
-        std::streampos start_pos = in.tellg();
-        char magic[8] = {0};
-        in.read(magic, 8);
-        std::streamsize magic_read = in.gcount();
-        if (magic_read < 4) {
-            throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read magic number");
-        }
-        std::string magic_str(magic, static_cast<size_t>(magic_read));
-
-        // Handle parallel container format: HUF_PAR
-        if (magic_str.rfind("HUF_PAR", 0) == 0) {
-            // Seek stream back so subsequent reads start just after the 7-byte magic
-            if (magic_read > 7) in.seekg(static_cast<std::streamoff>(7 - magic_read), std::ios::cur);
-            // Read number of chunks
-            uint32_t nChunks = 0;
-            in.read(reinterpret_cast<char*>(&nChunks), sizeof(nChunks));
-            if (!in) throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read chunk count");
-
-            std::vector<uint32_t> chunkSizes(nChunks);
-            for (uint32_t i = 0; i < nChunks; ++i) {
-                in.read(reinterpret_cast<char*>(&chunkSizes[i]), sizeof(chunkSizes[i]));
-                if (!in) throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read chunk size");
-            }
+// Split an interleaved payload (jump table + streams) into one BitReader per stream
+static void interleavedReaders(const unsigned char* payload, size_t payload_size, std::vector<BitReader>& readers) {
+    uint64_t sizes[STREAMS];
+    interleavedStreamSizes(payload, payload_size, sizes);
+    readers.clear();
+    readers.reserve(STREAMS);
+    size_t offset = JUMP_TABLE_SIZE;
+    for (unsigned s = 0; s < STREAMS; ++s) {
+        readers.emplace_back(payload + offset, static_cast<size_t>(sizes[s]));
+        offset += static_cast<size_t>(sizes[s]);
+    }
+}
 
-            // Process each chunk independently
-            std::vector<unsigned char> final_out;
-            for (uint32_t ci = 0; ci < nChunks; ++ci) {
-                uint32_t sz = chunkSizes[ci];
-                std::vector<unsigned char> chunkBuf(sz);
-                in.read(reinterpret_cast<char*>(chunkBuf.data()), sz);
-                std::streamsize got = in.gcount();
-                if (static_cast<uint32_t>(got) != sz) {
-                    throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk truncated");
-                }
+// Blocks at least this large get the multi-symbol table; below it the table costs more than it saves
+static constexpr size_t MULTI_SYMBOL_MIN_SIZE = 16 * 1024;
 
-                // Each chunk is itself a small HUF2-style blob: magic(4) + 256 code lengths + crc32 + compressed data
-                if (sz < 4 + 256 + 4) {
-                    throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk too small");
-                }
-                std::string chunk_magic(reinterpret_cast<char*>(chunkBuf.data()), 4);
-                if (chunk_magic != "HUF2") {
-                    throw huffman::HuffmanError(huffman::ErrorCode::INVALID_MAGIC, chunk_magic);
-                }
+// Decode exactly n bytes; byte i comes from readers[i % readers.size()]
+static void decodeBytes(const HuffmanDecoder& decoder, std::vector<BitReader>& readers, unsigned char* out, size_t n) {
+    const size_t stride = readers.size();
+    std::vector<size_t> next(stride);
+    for (size_t s = 0; s < stride; ++s) next[s] = s;
 
-                size_t pos = 4;
-                // Read original uncompressed size (uint64_t little-endian) if present (newer chunk format).
-                uint64_t orig_uncompressed = 0;
-                bool has_orig_size = false;
-                if (chunkBuf.size() >= pos + sizeof(uint64_t) + 256 + 4) {
-                    has_orig_size = true;
-                    for (size_t b = 0; b < sizeof(orig_uncompressed); ++b) {
-                        orig_uncompressed |= (uint64_t)chunkBuf[pos++] << (8 * b);
+    if (decoder.hasMultiSymbol()) {
+        // Each round does one lookup per stream; every stream must have room for MAX_LITERALS more bytes
+        const size_t reach = stride * (HuffmanDecoder::MAX_LITERALS - 1);
+        while (*std::max_element(next.begin(), next.end()) + reach < n) {
+            for (size_t s = 0; s < stride; ++s) {
+                uint8_t lit[HuffmanDecoder::MAX_LITERALS];
+                unsigned count = decoder.decodeLiterals(readers[s], lit);
+                if (count == 0) {
+                    int sym = decoder.decode(readers[s]);
+                    if (sym < 0) {
+                        throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Invalid Huffman code in chunk");
                     }
-                } else if (chunkBuf.size() >= pos + 256 + 4) {
-                    // Older chunk format without orig_size: proceed with code lengths at pos=4
-                    has_orig_size = false;
-                    orig_uncompressed = 0;
-                } else {
-                    throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk too small");
+                    lit[0] = static_cast<uint8_t>(sym);
+                    count = 1;
                 }
-                std::unordered_map<unsigned char, int> code_lens;
-                for (int i = 0; i < 256; ++i) {
-                    unsigned char len = chunkBuf[pos++];
-                    if (len > 0) code_lens[(unsigned char)i] = len;
+                for (unsigned j = 0; j < count; ++j) {
+                    out[next[s]] = lit[j];
+                    next[s] += stride;
                 }
+            }
+        }
+    } else if (stride == 4) {
+        // Four independent dependency chains per iteration
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            int s0 = decoder.decode(readers[0]);
+            int s1 = decoder.decode(readers[1]);
+            int s2 = decoder.decode(readers[2]);
+            int s3 = decoder.decode(readers[3]);
+            if ((s0 | s1 | s2 | s3) < 0) {
+                throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Invalid Huffman code in chunk");
+            }
+            out[i] = static_cast<unsigned char>(s0);
+            out[i + 1] = static_cast<unsigned char>(s1);
+            out[i + 2] = static_cast<unsigned char>(s2);
+            out[i + 3] = static_cast<unsigned char>(s3);
+        }
+        for (size_t s = 0; s < 4; ++s) next[s] = i + s;
+    }
 
-                uint32_t crc_stored = 0;
-                for (size_t b = 0; b < sizeof(crc_stored); ++b) {
-                    crc_stored |= (uint32_t)chunkBuf[pos++] << (8 * b);
-                }
+    // Tail (or everything, for other stream counts): one symbol at a time per stream
+    for (size_t s = 0; s < stride; ++s) {
+        for (; next[s] < n; next[s] += stride) {
+            int sym = decoder.decode(readers[s]);
+            if (sym < 0) {
+                throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Invalid Huffman code in chunk");
+            }
+            out[next[s]] = static_cast<unsigned char>(sym);
+        }
+    }
+}
 
-                std::vector<unsigned char> crc_buf;
-                if (pos < chunkBuf.size()) crc_buf.insert(crc_buf.end(), chunkBuf.begin() + pos, chunkBuf.end());
-                if (crc_buf.empty()) {
-                    throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "No compressed data in chunk");
-                }
+// Bytes a sliding LZ77 window hands to its sink at a time
+static constexpr size_t WINDOW_BLOCK_SIZE = 1 << 20;
 
-                uint32_t crc_calc = huffman::CRC32::calculate(crc_buf);
-                if (crc_calc != crc_stored) {
-                    throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "CRC32 mismatch in chunk: file may be corrupted");
-                }
+// Output of the LZ77 stage: data[0 .. pos) holds decoded bytes, which later
+// matches copy from. It is one of:
+// - a vector without a sink, grown to hold the whole output;
+// - a vector with a sink, used as a sliding window: when the next token might
+//   not fit, the bytes not yet emitted go to the sink and only the last
+//   LZ77::MAX_OFFSET bytes stay as history, so memory stays at the window plus
+//   WINDOW_BLOCK_SIZE;
+// - a fixed region of caller memory. Tokens are decoded in place while a whole
+//   token fits; the last few go to a small spill buffer so nothing is written
+//   past the region, and are copied into it by finish().
+struct LZOutput {
+    // Most one token can write: the longest match with its copy slack, and its literal
+    static constexpr size_t TOKEN_ROOM = LZ77::MAX_MATCH + LZ77::COPY_SLACK + 1;
 
-                // Reconstruct canonical codes for this chunk
-                std::vector<std::pair<unsigned char, int>> sorted;
-                for (const auto& kv : code_lens) sorted.push_back(kv);
-                std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
-                    if (a.second != b.second) return a.second < b.second;
-                    return a.first < b.first;
-                });
-                std::unordered_map<unsigned char, std::string> codes;
-                if (!sorted.empty()) {
-                    unsigned int code = 0;
-                    int prev_len = sorted.front().second;
-                    for (size_t i = 0; i < sorted.size(); ++i) {
-                        int len = sorted[i].second;
-                        if (i > 0) {
-                            ++code;
-                            if (len > prev_len) code <<= (len - prev_len);
-                        }
-                        prev_len = len;
-                        codes[sorted[i].first] = bitstring(code, len);
-                    }
-                }
-                std::unordered_map<std::string, unsigned char> rev_codes;
-                for (const auto& kv : codes) rev_codes[kv.second] = kv.first;
-
-                // Decode Huffman for this chunk
-                std::vector<unsigned char> huff_decoded;
-                {
-                    BitReader reader(crc_buf);
-                    std::string cur;
-                    while (reader.hasMoreBits()) {
-                        cur.clear();
-                        while (true) {
-                            if (!reader.hasMoreBits()) break;
-                            bool bit = reader.readBit();
-                            cur += bit ? '1' : '0';
-                            auto it = rev_codes.find(cur);
-                            if (it != rev_codes.end()) {
-                                huff_decoded.push_back(it->second);
-                                // If we have reached the expected uncompressed size, stop decoding
-                                if (orig_uncompressed > 0 && huff_decoded.size() >= orig_uncompressed) {
-                                    break;
-                                }
-                                break;
-                            }
-                        }
-                        if (orig_uncompressed > 0 && huff_decoded.size() >= orig_uncompressed) break;
-                    }
-                }
+    unsigned char* data;
+    size_t capacity;
+    size_t pos = 0;
+    std::vector<unsigned char>* buf;    // storage data points into; null in a fixed region until it spills
+    const huffman::StreamSink* sink = nullptr;
+    size_t emitted = 0;                 // data[0 .. emitted) already went to the sink
+    uint64_t limit = ~uint64_t(0);      // without a sink: most bytes the output may hold
+    unsigned char* region = nullptr;    // fixed region and its size
+    size_t region_size = 0;
+    size_t spill_base = 0;              // region offset of spill[0]
+    size_t spill_keep = 0;              // spill[0 .. spill_keep) is history already in the region
+    std::vector<unsigned char> spill;
+
+    explicit LZOutput(std::vector<unsigned char>& storage, const huffman::StreamSink* out_sink = nullptr)
+        : data(storage.data()), capacity(storage.size()), buf(&storage), sink(out_sink) {}
+    // Decode into region[history .. size); matches may reach back into region[0 .. history)
+    LZOutput(unsigned char* out_region, size_t history, size_t size)
+        : data(out_region), capacity(size), pos(history), buf(nullptr), region(out_region), region_size(size) {}
+
+    void reserveToken() {
+        if (capacity - pos < TOKEN_ROOM) makeRoom();
+    }
 
-                // Append decoded bytes for this chunk
-                final_out.insert(final_out.end(), huff_decoded.begin(), huff_decoded.end());
+    // Append length bytes starting offset bytes back; room must be reserved
+    void copyMatch(size_t offset, size_t length) {
+        // The window keeps at least MAX_OFFSET bytes of history once there are that many
+        if (offset == 0 || offset > pos) {
+            throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Match offset out of range");
+        }
+        if (length > LZ77::MAX_MATCH) {
+            throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Match length out of range");
+        }
+        unsigned char* dst = data + pos;
+        if (capacity - pos >= length + LZ77::COPY_SLACK) {
+            LZ77::copyMatch(dst, offset, length);
+        } else {
+            // Too close to the end of the buffer for the slack
+            const unsigned char* src = dst - offset;
+            for (size_t i = 0; i < length; ++i) dst[i] = src[i];
+        }
+        pos += length;
+    }
+
+    void makeRoom() {
+        if (!buf) {
+            // Fixed region: continue in spill with the history matches may need
+            spill_keep = std::min<size_t>(pos, LZ77::MAX_OFFSET);
+            spill_base = pos - spill_keep;
+            spill.assign(data + spill_base, data + pos);
+            spill.resize(region_size - spill_base + TOKEN_ROOM);
+            limit = region_size - spill_base;
+            buf = &spill;
+            data = spill.data();
+            capacity = spill.size();
+            pos = spill_keep;
+            return;
+        }
+        if (!sink) {
+            if (pos > limit) {
+                throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Decoded data exceeds the recorded size");
             }
+            buf->resize(std::max(capacity * 2, pos + TOKEN_ROOM + 4096));
+            data = buf->data();
+            capacity = buf->size();
+            return;
+        }
+        if (pos > emitted) (*sink)(data + emitted, pos - emitted);
+        const size_t keep = std::min<size_t>(pos, LZ77::MAX_OFFSET);
+        if (keep > 0) std::memmove(data, data + pos - keep, keep);
+        pos = emitted = keep;
+        if (capacity < keep + WINDOW_BLOCK_SIZE) {
+            buf->resize(LZ77::MAX_OFFSET + WINDOW_BLOCK_SIZE);
+            data = buf->data();
+            capacity = buf->size();
+        }
+    }
 
-            // Write combined output file
-            std::ofstream out(outPath, std::ios::binary);
-            if (!out) {
-                throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
+    // Emits the rest to the sink, copies spilled bytes into the fixed region, or
+    // trims the vector to the decoded bytes. Afterwards pos is the output size
+    // (for a region, counted from its start).
+    void finish() {
+        if (sink) {
+            if (pos > emitted) (*sink)(data + emitted, pos - emitted);
+            emitted = pos;
+        } else if (region) {
+            if (buf) {
+                const size_t end = std::min<size_t>(pos, region_size - spill_base);
+                if (end > spill_keep) std::memcpy(region + spill_base + spill_keep, data + spill_keep, end - spill_keep);
+                pos += spill_base;
+                data = region;
+                capacity = region_size;
             }
-            out.write(reinterpret_cast<const char*>(final_out.data()), final_out.size());
-            if (out.bad()) {
-                throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
+        } else {
+            buf->resize(pos);
+        }
+    }
+};
+
+// Decode literal/length + distance tokens until END_OF_BLOCK. Token i is read
+// from readers[i % readers.size()], matching the encoder's round-robin layout.
+// With a multi-symbol literal table, extra literals from one lookup are
+// literal-only tokens of later turns of the same stream and wait in pending.
+static void decodeHybridTokens(const HuffmanDecoder& litlen, const HuffmanDecoder& dist,
+                               std::vector<BitReader>& readers, LZOutput& out) {
+    struct Pending {
+        uint8_t literals[HuffmanDecoder::MAX_LITERALS];
+        unsigned head = 0, count = 0;
+    };
+    Pending pending[huffman::INTERLEAVED_STREAMS];
+    const bool multi = litlen.hasMultiSymbol();
+    size_t k = 0;
+    while (true) {
+        out.reserveToken();
+        unsigned char* buf = out.data;
+        BitReader& reader = readers[k];
+        Pending& p = pending[k];
+        if (++k == readers.size()) k = 0;
+        if (p.head < p.count) {
+            buf[out.pos++] = p.literals[p.head++];
+            continue;
+        }
+        if (multi) {
+            unsigned count = litlen.decodeLiterals(reader, p.literals);
+            if (count > 0) {
+                buf[out.pos++] = p.literals[0];
+                p.head = 1;
+                p.count = count;
+                continue;
             }
-            return true;
         }
+        int sym = litlen.decode(reader);
+        if (sym < 0) {
+            throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Invalid literal/length code");
+        }
+        if (sym < 256) {
+            buf[out.pos++] = static_cast<unsigned char>(sym);
+            continue;
+        }
+        if (sym == static_cast<int>(LZ77::END_OF_BLOCK)) break;
+        unsigned lcode = sym - LZ77::END_OF_BLOCK - 1;
+        if (lcode >= 29) {
+            throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Invalid length code");
+        }
+        size_t length = LZ77::LENGTH_BASE[lcode] + reader.readBits(LZ77::LENGTH_EXTRA[lcode]);
+        int dsym = dist.decode(reader);
+        if (dsym < 0 || dsym >= static_cast<int>(LZ77::DIST_SYMBOLS)) {
+            throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Invalid distance code");
+        }
+        size_t offset = LZ77::DIST_BASE[dsym] + reader.readBits(LZ77::DIST_EXTRA[dsym]);
+        out.copyMatch(offset, length);
+    }
+    out.finish();
+}
+
+// Fused decode of HUF_LZ77 tokens: the fields of each token are read straight
+// from the Huffman symbols and the token is expanded into out, with no byte or
+// token vector in between. Each token is a u16 offset and u16 length (big-endian),
+// then the literal. A trailing partial token (decoded from padding bits) is
+// dropped, as the encoder of this format did.
+static void decodeTokenBytes(const HuffmanDecoder& decoder, BitReader& reader, LZOutput& out) {
+    int b[5];
+    while (true) {
+        for (int& v : b) {
+            if ((v = decoder.decode(reader)) < 0) return;
+        }
+        const size_t offset = static_cast<size_t>(b[0] << 8 | b[1]);
+        const size_t length = static_cast<size_t>(b[2] << 8 | b[3]);
+        out.reserveToken();
+        if (length > 0) out.copyMatch(offset, length);
+        out.data[out.pos++] = static_cast<unsigned char>(b[4]);
+    }
+}
 
-        bool is_hybrid = false;
-        if (magic_str.rfind("HUF_LZ77", 0) == 0) {
-            is_hybrid = true;
-        } else if (magic_str.substr(0,4) == "HUF2" || magic_str.substr(0,4) == "HUF1") {
-            // legacy Huffman
+// Header fields of one HUF_PAR chunk blob: HUF2 (single stream), HUF4 (interleaved
+// streams) or HLZ5 (LZ77 + Huffman, interleaved streams)
+struct ChunkView {
+    bool interleaved = false;
+    bool hybrid = false;
+    bool has_size = false;          // false only for the oldest HUF2 chunks
+    uint64_t orig_size = 0;
+    uint32_t dict_size = 0;         // HLZ5: bytes of preceding output used as LZ77 history
+    const uint8_t* code_lens = nullptr; // 256 entries; HLZ5: LZ77::LITLEN_SYMBOLS
+    const uint8_t* dist_lens = nullptr; // HLZ5 only: LZ77::DIST_SYMBOLS entries
+    uint32_t crc = 0;
+    const unsigned char* payload = nullptr;
+    size_t payload_size = 0;
+    bool has_checksum = false;      // HUF_PAR2: CRC32 of the decoded chunk from the index
+    uint32_t checksum = 0;
+};
+
+static ChunkView parseChunk(const unsigned char* data, size_t sz) {
+    // Each chunk is itself a small HUF2-style blob: magic(4) [+ orig size(8)] + 256 code lengths + crc32 + compressed data
+    if (sz < 4 + 256 + 4) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk too small");
+    }
+    std::string chunk_magic(reinterpret_cast<const char*>(data), 4);
+    ChunkView view;
+    if (chunk_magic == "HLZ5") {
+        // magic(4) + orig size(8) + dictionary size(4) + litlen and distance code lengths + crc32 + compressed data
+        size_t pos = 4;
+        if (sz < pos + sizeof(uint64_t) + sizeof(uint32_t) + LZ77::LITLEN_SYMBOLS + LZ77::DIST_SYMBOLS + 4 + 1) {
+            throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk too small");
+        }
+        view.interleaved = view.hybrid = view.has_size = true;
+        for (size_t b = 0; b < sizeof(view.orig_size); ++b) view.orig_size |= (uint64_t)data[pos++] << (8 * b);
+        for (size_t b = 0; b < sizeof(view.dict_size); ++b) view.dict_size |= (uint32_t)data[pos++] << (8 * b);
+        view.code_lens = data + pos;
+        pos += LZ77::LITLEN_SYMBOLS;
+        view.dist_lens = data + pos;
+        pos += LZ77::DIST_SYMBOLS;
+        for (size_t b = 0; b < sizeof(view.crc); ++b) view.crc |= (uint32_t)data[pos++] << (8 * b);
+        view.payload = data + pos;
+        view.payload_size = sz - pos;
+        return view;
+    }
+    view.interleaved = chunk_magic == "HUF4";
+    if (chunk_magic != "HUF2" && !view.interleaved) {
+        throw huffman::HuffmanError(huffman::ErrorCode::INVALID_MAGIC, chunk_magic);
+    }
+
+    size_t pos = 4;
+    // Read original uncompressed size (uint64_t little-endian) if present (newer chunk format).
+    if (sz >= pos + sizeof(uint64_t) + 256 + 4) {
+        view.has_size = true;
+        for (size_t b = 0; b < sizeof(view.orig_size); ++b) {
+            view.orig_size |= (uint64_t)data[pos++] << (8 * b);
+        }
+    } else if (view.interleaved) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk too small");
+    }
+    // Otherwise: older HUF2 chunk without orig_size, code lengths start at pos=4
+    view.code_lens = data + pos;
+    pos += 256;
+    for (size_t b = 0; b < sizeof(view.crc); ++b) {
+        view.crc |= (uint32_t)data[pos++] << (8 * b);
+    }
+    view.payload = data + pos;
+    view.payload_size = sz - pos;
+    if (view.payload_size == 0) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "No compressed data in chunk");
+    }
+    return view;
+}
+
+static void verifyChunk(const ChunkView& chunk) {
+    if (huffman::CRC32::calculate(chunk.payload, chunk.payload_size) != chunk.crc) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "CRC32 mismatch in chunk: file may be corrupted");
+    }
+}
+
+static HuffmanDecoder checkedChunkDecoder(const ChunkView& chunk) {
+    verifyChunk(chunk);
+    return HuffmanDecoder(std::vector<uint8_t>(chunk.code_lens, chunk.code_lens + 256));
+}
+
+// HLZ5: the dictionary is the `dict_size` bytes right before out, i.e. the end of
+// the previous chunk's slice, which must already be decoded
+static void decodeHybridChunkInto(const ChunkView& chunk, unsigned char* out, size_t history) {
+    verifyChunk(chunk);
+    if (chunk.dict_size > history) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk dictionary reaches before the start of the output");
+    }
+    HuffmanDecoder litlen(std::vector<uint8_t>(chunk.code_lens, chunk.code_lens + LZ77::LITLEN_SYMBOLS));
+    HuffmanDecoder dist(std::vector<uint8_t>(chunk.dist_lens, chunk.dist_lens + LZ77::DIST_SYMBOLS));
+    if (chunk.payload_size >= MULTI_SYMBOL_MIN_SIZE / 4) litlen.buildMultiSymbol();
+    std::vector<BitReader> readers;
+    interleavedReaders(chunk.payload, chunk.payload_size, readers);
+    // Decoded in place; the dictionary is read from the previous slice but never written
+    LZOutput lz(out - chunk.dict_size, chunk.dict_size, chunk.dict_size + chunk.orig_size);
+    decodeHybridTokens(litlen, dist, readers, lz);
+    if (lz.pos != chunk.dict_size + chunk.orig_size) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk size mismatch");
+    }
+}
+
+// Verify and decode a sized chunk into out[0 .. orig_size); `history` bytes of
+// earlier output precede out
+static void decodeChunkInto(const ChunkView& chunk, unsigned char* out, size_t history) {
+    if (chunk.hybrid) {
+        decodeHybridChunkInto(chunk, out, history);
+    } else {
+        HuffmanDecoder decoder = checkedChunkDecoder(chunk);
+        std::vector<BitReader> readers;
+        if (chunk.interleaved) {
+            interleavedReaders(chunk.payload, chunk.payload_size, readers);
         } else {
-            throw huffman::HuffmanError(huffman::ErrorCode::INVALID_MAGIC, magic_str);
+            readers.emplace_back(chunk.payload, chunk.payload_size);
         }
+        if (chunk.orig_size >= MULTI_SYMBOL_MIN_SIZE) decoder.buildMultiSymbol();
+        decodeBytes(decoder, readers, out, chunk.orig_size);
+    }
+    if (chunk.has_checksum && huffman::CRC32::calculate(out, chunk.orig_size) != chunk.checksum) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk data checksum mismatch: file may be corrupted");
+    }
+}
 
-        // Read 256 code lengths
-        std::unordered_map<unsigned char, int> code_lens;
-        for (int i = 0; i < 256; ++i) {
-            int len = in.get();
-            if (len < 0) throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Unexpected end of file while reading code lengths");
-            if (len > 0) code_lens[(unsigned char)i] = len;
+// Older HUF2 chunk without a size: decode until no complete code remains
+static std::vector<unsigned char> decodeUnsizedChunk(const ChunkView& chunk) {
+    HuffmanDecoder decoder = checkedChunkDecoder(chunk);
+    BitReader reader(chunk.payload, chunk.payload_size);
+    std::vector<unsigned char> huff_decoded;
+    while (true) {
+        int sym = decoder.decode(reader);
+        if (sym < 0) break;
+        huff_decoded.push_back(static_cast<unsigned char>(sym));
+    }
+    return huff_decoded;
+}
+
+// Every payload bit yields at most one byte of a Huffman chunk, or one token of
+// MAX_MATCH + 1 bytes of an LZ77 payload, which bounds the allocation a corrupted
+// size can ask for
+static void checkRecordedSize(uint64_t orig_size, uint64_t payload_size, bool hybrid) {
+    if (orig_size / 8 / (hybrid ? LZ77::MAX_MATCH + 1 : 1) > payload_size) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Recorded size exceeds what the payload can hold");
+    }
+}
+
+// Append the end of chunk's output slice to offsets, which start at offsets[0]
+static void appendChunkEnd(std::vector<size_t>& offsets, const ChunkView& chunk) {
+    checkRecordedSize(chunk.orig_size, chunk.payload_size, chunk.hybrid);
+    if (chunk.orig_size > SIZE_MAX - offsets.back()) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk sizes overflow the output size");
+    }
+    offsets.push_back(offsets.back() + static_cast<size_t>(chunk.orig_size));
+}
+
+// Decode sized chunks on the shared pool, each into its slice of `output`.
+// Helpers take chunk indices from a shared counter. on_ready(i) runs on the
+// calling thread for i = 0, 1, ... as soon as chunk i and all earlier chunks
+// are done, so output can be written in order while later chunks decode.
+// While chunk i is still pending the caller decodes unclaimed chunks itself.
+template <typename OnReady>
+static void decodeChunksParallel(const std::vector<ChunkView>& chunks, const std::vector<size_t>& offsets,
+                                 unsigned char* output, OnReady on_ready) {
+    const size_t n = chunks.size();
+    // Shared with helper tasks, which may start after this call has returned
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<unsigned> active{0};
+        std::atomic<bool> abort{false};
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::vector<char> done;
+        std::vector<std::exception_ptr> errors;
+    };
+    auto state = std::make_shared<State>();
+    state->done.assign(n, 0);
+    state->errors.resize(n);
+
+    // Claims and decodes one chunk; false once none are left
+    auto decodeOne = [state, n, &chunks, &offsets, output]() {
+        if (state->abort.load()) return false;
+        size_t i = state->next.fetch_add(1);
+        if (i >= n) return false;
+        std::exception_ptr error;
+        try {
+            decodeChunkInto(chunks[i], output + offsets[i], offsets[i]);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            state->errors[i] = error;
+            state->done[i] = 1;
         }
+        state->cv.notify_all();
+        return true;
+    };
 
-        // Handle empty file case
-        if (code_lens.empty()) {
-            std::ofstream out(outPath, std::ios::binary);
-            if (!out) {
-                throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
+    huffman::ThreadPool& pool = huffman::ThreadPool::shared();
+    size_t helpers = std::min<size_t>(pool.size(), n - 1);
+    for (size_t h = 0; h < helpers; ++h) {
+        pool.submit([state, decodeOne]() {
+            state->active.fetch_add(1);
+            while (decodeOne()) {}
+            if (state->active.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(state->mtx);
+                state->cv.notify_all();
             }
-            // Empty file - just create empty output
+        });
+    }
+
+    // On any exit, stop helpers from claiming chunks and wait for those still decoding
+    struct Drain {
+        State& state;
+        ~Drain() {
+            state.abort = true;
+            std::unique_lock<std::mutex> lock(state.mtx);
+            state.cv.wait(lock, [this] { return state.active.load() == 0; });
+        }
+    } drain{*state};
+
+    for (size_t i = 0; i < n; ++i) {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(state->mtx);
+                if (state->done[i]) break;
+                if (state->next.load() >= n) {
+                    state->cv.wait(lock, [&] { return state->done[i] != 0; });
+                    break;
+                }
+            }
+            decodeOne();
+        }
+        if (state->errors[i]) std::rethrow_exception(state->errors[i]);
+        on_ready(i);
+    }
+}
+
+// Decode sized chunks into their slices of output[0 .. offsets.back()) and call
+// on_ready(i) in order.
+// A primed chunk reads the end of the previous one, so such a set decodes in order.
+template <typename OnReady>
+static void decodeSizedChunks(const std::vector<ChunkView>& chunks, const std::vector<size_t>& offsets,
+                              unsigned char* output, OnReady on_ready) {
+    if (chunks.empty()) return;
+    bool primed = std::any_of(chunks.begin(), chunks.end(), [](const ChunkView& c) { return c.dict_size > 0; });
+    if (!primed) {
+        decodeChunksParallel(chunks, offsets, output, on_ready);
+        return;
+    }
+    for (size_t ci = 0; ci < chunks.size(); ++ci) {
+        decodeChunkInto(chunks[ci], output + offsets[ci], offsets[ci]);
+        on_ready(ci);
+    }
+}
+
+// Chunks decoded together when output is streamed: enough to keep the pool busy
+static size_t chunkBatchSize() {
+    return 2 * (huffman::ThreadPool::shared().size() + 1);
+}
+
+// Drop all but the last LZ77::MAX_OFFSET bytes, the history a primed chunk may use
+static void keepHistory(std::vector<unsigned char>& window) {
+    window.erase(window.begin(), window.end() - std::min<size_t>(window.size(), LZ77::MAX_OFFSET));
+}
+
+// Decode a batch of sized chunks after the history held in window and send each
+// to sink in order. offsets are relative to the batch, as parsePar2Chunks makes them.
+static void decodeChunkBatch(const std::vector<ChunkView>& chunks, std::vector<size_t> offsets,
+                             std::vector<unsigned char>& window, const huffman::StreamSink& sink) {
+    const size_t history = window.size();
+    for (size_t& offset : offsets) offset += history;
+    window.resize(offsets.back());
+    decodeSizedChunks(chunks, offsets, window.data(), [&](size_t ci) {
+        sink(window.data() + offsets[ci], offsets[ci + 1] - offsets[ci]);
+    });
+    keepHistory(window);
+}
+
+// Load the chunk index of a HUF_PAR2 file of fileSize bytes. readAt(offset, n, dst)
+// copies n bytes from offset and returns false if the file ends first. Returns
+// false when there is no index footer (a legacy HUF_PAR file); throws when the
+// footer is present but the index is damaged.
+template <typename ReadAt>
+static bool readPar2Index(uint64_t fileSize, ReadAt readAt, std::vector<huffman::ChunkIndexEntry>& index) {
+    if (fileSize < huffman::PAR2_MAGIC_SIZE + huffman::PAR2_FOOTER_SIZE) return false;
+    unsigned char footer[huffman::PAR2_FOOTER_SIZE];
+    if (!readAt(fileSize - huffman::PAR2_FOOTER_SIZE, sizeof(footer), footer) ||
+        std::string(reinterpret_cast<const char*>(footer + 20), 4) != huffman::PAR2_FOOTER_MAGIC) {
+        return false;
+    }
+    const uint64_t indexOffset = huffman::readLittleEndian(footer, 8);
+    const uint64_t count = huffman::readLittleEndian(footer + 8, 8);
+    const uint32_t indexCrc = static_cast<uint32_t>(huffman::readLittleEndian(footer + 16, 4));
+    const uint64_t indexEnd = fileSize - huffman::PAR2_FOOTER_SIZE;
+    if (indexOffset < huffman::PAR2_MAGIC_SIZE || indexOffset > indexEnd ||
+        (indexEnd - indexOffset) / huffman::CHUNK_INDEX_ENTRY_SIZE != count ||
+        (indexEnd - indexOffset) % huffman::CHUNK_INDEX_ENTRY_SIZE != 0) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk index does not fit the file");
+    }
+
+    std::vector<unsigned char> raw(static_cast<size_t>(indexEnd - indexOffset));
+    if (!readAt(indexOffset, raw.size(), raw.data())) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk index truncated");
+    }
+    if (huffman::CRC32::calculate(raw) != indexCrc) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "CRC32 mismatch in chunk index: file may be corrupted");
+    }
+
+    // Chunks are stored back to back and cover the output without gaps; no chunk
+    // claims more output than its blob can hold
+    index.clear();
+    index.reserve(static_cast<size_t>(count));
+    uint64_t compressedPos = huffman::PAR2_MAGIC_SIZE;
+    uint64_t originalPos = 0;
+    for (uint64_t ci = 0; ci < count; ++ci) {
+        huffman::ChunkIndexEntry entry = huffman::parseIndexEntry(raw.data() + ci * huffman::CHUNK_INDEX_ENTRY_SIZE);
+        if (entry.compressed_offset != compressedPos || entry.compressed_size > indexOffset - compressedPos ||
+            entry.original_offset != originalPos || entry.original_size > UINT64_MAX - originalPos) {
+            throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk index entry out of range");
+        }
+        checkRecordedSize(entry.original_size, entry.compressed_size, true);
+        compressedPos += entry.compressed_size;
+        originalPos += entry.original_size;
+        index.push_back(entry);
+    }
+    if (compressedPos != indexOffset) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk index does not cover the chunk data");
+    }
+    return true;
+}
+
+// Parse chunks [first, last) of a HUF_PAR2 file and check each header against its
+// index entry. `base` holds the file from offset `baseOffset` up to the end of
+// chunk last - 1. Chunk ci's output starts at offsets[ci - first].
+static std::vector<ChunkView> parsePar2Chunks(const unsigned char* base, uint64_t baseOffset,
+                                              const std::vector<huffman::ChunkIndexEntry>& index,
+                                              size_t first, size_t last, std::vector<size_t>& offsets) {
+    std::vector<ChunkView> chunks;
+    chunks.reserve(last - first);
+    offsets.assign(1, 0);
+    for (size_t ci = first; ci < last; ++ci) {
+        const huffman::ChunkIndexEntry& entry = index[ci];
+        ChunkView view = parseChunk(base + (entry.compressed_offset - baseOffset), static_cast<size_t>(entry.compressed_size));
+        if (!view.has_size || view.orig_size != entry.original_size || view.dict_size != entry.dict_size) {
+            throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk header does not match the chunk index");
+        }
+        view.has_checksum = true;
+        view.checksum = entry.checksum;
+        chunks.push_back(view);
+        appendChunkEnd(offsets, view);
+    }
+    return chunks;
+}
+
+// Sequential, bounds-checked reads from a compressed buffer
+struct ByteCursor {
+    const unsigned char* data;
+    size_t size;
+    size_t pos;
+
+    size_t remaining() const { return size - pos; }
+
+    const unsigned char* take(size_t n, const char* error) {
+        if (n > remaining()) {
+            throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, error);
+        }
+        const unsigned char* p = data + pos;
+        pos += n;
+        return p;
+    }
+
+    // Native byte order, as the stream-based writers stored these fields
+    template <typename T>
+    T read(const char* error) {
+        T value;
+        std::memcpy(&value, take(sizeof(T), error), sizeof(T));
+        return value;
+    }
+};
+
+// Rebuild decoder unless it was last built from the same n code lengths
+static void reuseOrBuild(HuffmanDecoder& decoder, std::vector<uint8_t>& built_from, const uint8_t* lens, size_t n) {
+    if (built_from.size() == n && std::equal(lens, lens + n, built_from.begin())) return;
+    // Cleared first so a failed build is never taken for a match
+    built_from.clear();
+    std::vector<uint8_t> code_lens(lens, lens + n);
+    decoder.build(code_lens);
+    built_from = std::move(code_lens);
+}
+
+// Literal/length and distance decoders of a HUF_LZV6 payload of payload_size bytes
+static void useHybridTables(huffman::DecompressScratch& scratch, const uint8_t* litlen_lens, const uint8_t* dist_lens,
+                            uint64_t payload_size) {
+    // Decode tables left by an earlier buffer with the same code lengths are reused
+    reuseOrBuild(scratch.litlen, scratch.litlen_lens, litlen_lens, LZ77::LITLEN_SYMBOLS);
+    reuseOrBuild(scratch.dist, scratch.dist_lens, dist_lens, LZ77::DIST_SYMBOLS);
+    if (payload_size >= MULTI_SYMBOL_MIN_SIZE / 4 && !scratch.litlen.hasMultiSymbol()) scratch.litlen.buildMultiSymbol();
+}
+
+// Decode the HUF_LZV6 tokens in scratch.readers, a payload of payload_size bytes,
+// and check the result against the recorded orig_size and orig_crc
+static void decodeSizedTokens(huffman::DecompressScratch& scratch, uint64_t payload_size, uint64_t orig_size,
+                              uint32_t orig_crc, std::vector<unsigned char>& out, const huffman::StreamSink* sink) {
+    checkRecordedSize(orig_size, payload_size, true);
+    uint64_t total = 0;
+    uint32_t crc = 0;
+    // With a sink, output is counted and checksummed as it passes
+    const huffman::StreamSink checked = [&](const uint8_t* block, size_t n) {
+        total += n;
+        if (total > orig_size) {
+            throw huffman::HuffmanError(huffman::ErrorCode::DECOMPRESSION_FAILED, "Decoded data exceeds the recorded size");
+        }
+        crc = huffman::CRC32::update(crc, block, n);
+        (*sink)(block, n);
+    };
+    // Without a sink, allocated once: the token room is only used up past the recorded size
+    if (!sink) out.resize(static_cast<size_t>(orig_size) + LZOutput::TOKEN_ROOM);
+    LZOutput lz(out, sink ? &checked : nullptr);
+    if (!sink) lz.limit = orig_size;
+    decodeHybridTokens(scratch.litlen, scratch.dist, scratch.readers, lz);
+    if (!sink) {
+        total = out.size();
+        crc = huffman::CRC32::calculate(out);
+    }
+    if (total != orig_size) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Decoded size does not match the header");
+    }
+    if (crc != orig_crc) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "CRC32 mismatch in decoded data: file may be corrupted");
+    }
+}
+
+// Chunk list of a legacy HUF_PAR image: 7-byte magic, chunk count, chunk sizes, blobs.
+// Chunk views point straight into the input.
+static std::vector<ChunkView> parseParChunks(const unsigned char* data, size_t size) {
+    ByteCursor in{data, size, 7};
+    uint32_t nChunks = in.read<uint32_t>("Cannot read chunk count");
+    if (nChunks > in.remaining() / sizeof(uint32_t)) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read chunk size");
+    }
+    std::vector<uint32_t> chunkSizes(nChunks);
+    for (uint32_t i = 0; i < nChunks; ++i) chunkSizes[i] = in.read<uint32_t>("Cannot read chunk size");
+
+    std::vector<ChunkView> chunks;
+    chunks.reserve(nChunks);
+    for (uint32_t ci = 0; ci < nChunks; ++ci) {
+        const unsigned char* blob = in.take(chunkSizes[ci], "Chunk truncated");
+        chunks.push_back(parseChunk(blob, chunkSizes[ci]));
+    }
+    return chunks;
+}
+
+// Chunks and output offsets of a container whose decoded size is known up front:
+// HUF_PAR2, or HUF_PAR whose chunks all carry their size. False for any other image.
+static bool parseSizedContainer(const unsigned char* data, size_t size,
+                                std::vector<ChunkView>& chunks, std::vector<size_t>& offsets) {
+    if (size >= huffman::PAR2_MAGIC_SIZE && std::memcmp(data, huffman::PAR2_MAGIC, huffman::PAR2_MAGIC_SIZE) == 0) {
+        std::vector<huffman::ChunkIndexEntry> index;
+        auto readAt = [data, size](uint64_t offset, size_t n, unsigned char* dst) {
+            if (offset > size || n > size - offset) return false;
+            std::copy(data + offset, data + offset + n, dst);
+            return true;
+        };
+        if (readPar2Index(size, readAt, index)) {
+            chunks = parsePar2Chunks(data, 0, index, 0, index.size(), offsets);
             return true;
         }
+    }
+    if (size < 7 || std::memcmp(data, "HUF_PAR", 7) != 0) return false;
+    chunks = parseParChunks(data, size);
+    offsets.assign(1, 0);
+    for (const ChunkView& chunk : chunks) {
+        if (!chunk.has_size) return false;
+        appendChunkEnd(offsets, chunk);
+    }
+    return true;
+}
 
-        // Read CRC32
-        uint32_t crc_stored = 0;
-        in.read(reinterpret_cast<char*>(&crc_stored), sizeof(crc_stored));
-        if (!in) {
-            throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read CRC32");
+// Decode a complete compressed file image. Without a sink, out receives all of the
+// output. With one, output goes to the sink as soon as it is final and out is only
+// working storage: containers decode a batch of chunks at a time, streams one block
+// at a time and single-stream formats through a sliding window, so out stays bounded.
+static void decodeBuffer(const unsigned char* data, size_t size, std::vector<unsigned char>& out,
+                         const huffman::StreamSink* sink, huffman::DecompressScratch& scratch) {
+    out.clear();
+    // Magic is up to 8 bytes
+    const size_t magic_read = std::min<size_t>(size, 8);
+    if (magic_read < 4) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read magic number");
+    }
+    std::string magic_str(reinterpret_cast<const char*>(data), magic_read);
+    ByteCursor in{data, size, magic_read};
+
+    // Containers with sized chunks decode into their slices of one preallocated buffer
+    std::vector<ChunkView> chunks;
+    std::vector<size_t> outOffsets;
+    if (parseSizedContainer(data, size, chunks, outOffsets)) {
+        if (!sink) {
+            out.resize(outOffsets.back());
+            decodeSizedChunks(chunks, outOffsets, out.data(), [](size_t) {});
+            return;
+        }
+        for (size_t first = 0; first < chunks.size(); first += chunkBatchSize()) {
+            const size_t last = std::min(chunks.size(), first + chunkBatchSize());
+            std::vector<size_t> offsets(1, 0);
+            for (size_t ci = first; ci < last; ++ci) appendChunkEnd(offsets, chunks[ci]);
+            decodeChunkBatch(std::vector<ChunkView>(chunks.begin() + first, chunks.begin() + last), offsets, out, *sink);
         }
+        return;
+    }
 
-        // Read all compressed data into buffer
-        std::vector<unsigned char> crc_buf;
-        {
-            std::streampos data_start = in.tellg();
-            in.seekg(0, std::ios::end);
-            std::streampos data_end = in.tellg();
-            size_t data_size = static_cast<size_t>(data_end - data_start);
-            in.seekg(data_start, std::ios::beg);
-            if (data_size == 0) {
-                throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "No compressed data found");
-            }
-            crc_buf.resize(data_size);
-            in.read(reinterpret_cast<char*>(crc_buf.data()), data_size);
-            if (!in) {
-                throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Failed to read compressed data");
+    // Framed stream: blocks decode one after another
+    if (magic_str == huffman::STREAM_MAGIC) {
+        huffman::StreamDecompressor stream;
+        if (sink) {
+            stream.begin(*sink);
+        } else {
+            stream.begin([&](const uint8_t* block, size_t n) { out.insert(out.end(), block, block + n); });
+        }
+        stream.update(data, size);
+        stream.finish();
+        return;
+    }
+
+    // Older HUF_PAR files with unsized chunks: decode one chunk after another
+    if (magic_str.rfind("HUF_PAR", 0) == 0) {
+        for (const ChunkView& chunk : parseParChunks(data, size)) {
+            std::vector<size_t> offsets(1, sink ? 0 : out.size());
+            if (chunk.has_size) {
+                appendChunkEnd(offsets, chunk);
+                out.resize(offsets.back());
+                decodeChunkInto(chunk, out.data() + offsets[0], 0);
+            } else {
+                std::vector<unsigned char> huff_decoded = decodeUnsizedChunk(chunk);
+                out.resize(offsets[0]);
+                out.insert(out.end(), huff_decoded.begin(), huff_decoded.end());
             }
+            if (sink) (*sink)(out.data(), out.size());
         }
+        return;
+    }
 
-        // Verify CRC over raw compressed bitstream
-        uint32_t crc_calc = huffman::CRC32::calculate(crc_buf);
-        if (crc_calc != crc_stored) {
+    // Hybrid with DEFLATE-style literal/length and distance alphabets over 4
+    // interleaved streams, behind the original size and CRC32
+    if (size >= huffman::LZV6_MAGIC_SIZE && huffman::isSizedImage(data)) {
+        const uint8_t* fields = in.take(huffman::LZV6_SIZE_FIELDS, "Cannot read original size");
+        const uint64_t orig_size = huffman::readLittleEndian(fields, 8);
+        const uint32_t orig_crc = static_cast<uint32_t>(huffman::readLittleEndian(fields + 8, 4));
+        if (orig_size == 0) {
+            if (in.remaining() != 0) {
+                throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Data after an empty image");
+            }
+            return;
+        }
+        const uint8_t* litlen_lens = in.take(LZ77::LITLEN_SYMBOLS, "Cannot read code length tables");
+        const uint8_t* dist_lens = in.take(LZ77::DIST_SYMBOLS, "Cannot read code length tables");
+        uint32_t crc_stored = in.read<uint32_t>("Cannot read code length tables");
+        const unsigned char* payload = data + in.pos;
+        const size_t payload_size = in.remaining();
+        if (huffman::CRC32::calculate(payload, payload_size) != crc_stored) {
             throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "CRC32 mismatch: file may be corrupted");
         }
 
-        // Reconstruct canonical codes
-        std::vector<std::pair<unsigned char, int>> sorted;
-        for (const auto& kv : code_lens) sorted.push_back(kv);
-        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
-            if (a.second != b.second) return a.second < b.second;
-            return a.first < b.first;
-        });
-        std::unordered_map<unsigned char, std::string> codes;
-        if (!sorted.empty()) {
-            unsigned int code = 0;
-            int prev_len = sorted.front().second;
-            for (size_t i = 0; i < sorted.size(); ++i) {
-                int len = sorted[i].second;
-                if (i > 0) {
-                    ++code;
-                    if (len > prev_len) code <<= (len - prev_len);
-                }
-                prev_len = len;
-                codes[sorted[i].first] = bitstring(code, len);
+        useHybridTables(scratch, litlen_lens, dist_lens, payload_size);
+        interleavedReaders(payload, payload_size, scratch.readers);
+        decodeSizedTokens(scratch, payload_size, orig_size, orig_crc, out, sink);
+        return;
+    }
+
+    // Empty input written by older versions: "HUF1" and a zero table size
+    if (size == 6 && magic_str == std::string("HUF1\0\0", 6)) return;
+
+    bool is_hybrid = false;
+    if (magic_str.rfind("HUF_LZ77", 0) == 0) {
+        is_hybrid = true;
+    } else if (magic_str.substr(0,4) == "HUF2" || magic_str.substr(0,4) == "HUF1") {
+        // legacy Huffman
+    } else {
+        throw huffman::HuffmanError(huffman::ErrorCode::INVALID_MAGIC, magic_str);
+    }
+
+    // Read 256 code lengths
+    const uint8_t* lens = in.take(256, "Unexpected end of file while reading code lengths");
+    std::vector<uint8_t> code_lens(lens, lens + 256);
+
+    // Handle empty file case
+    if (std::all_of(code_lens.begin(), code_lens.end(), [](uint8_t len) { return len == 0; })) {
+        return;
+    }
+
+    uint32_t crc_stored = in.read<uint32_t>("Cannot read CRC32");
+    const unsigned char* payload = data + in.pos;
+    const size_t payload_size = in.remaining();
+    if (payload_size == 0) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "No compressed data found");
+    }
+
+    // Verify CRC over raw compressed bitstream
+    if (huffman::CRC32::calculate(payload, payload_size) != crc_stored) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "CRC32 mismatch: file may be corrupted");
+    }
+
+    // Huffman symbols go straight into the output: token fields for hybrid mode,
+    // bytes otherwise
+    HuffmanDecoder decoder(code_lens);
+    BitReader reader(payload, payload_size);
+    LZOutput lz(out, sink);
+    if (is_hybrid) {
+        decodeTokenBytes(decoder, reader, lz);
+    } else {
+        for (int sym; (sym = decoder.decode(reader)) >= 0;) {
+            lz.reserveToken();
+            lz.data[lz.pos++] = static_cast<unsigned char>(sym);
+        }
+    }
+    lz.finish();
+}
+
+void huffman::DecompressContext::decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    decodeBuffer(data, size, out, nullptr, scratch_);
+}
+
+size_t huffman::DecompressContext::decompressInto(const uint8_t* data, size_t size, uint8_t* dst, size_t capacity) {
+    std::vector<ChunkView> chunks;
+    std::vector<size_t> offsets;
+    if (parseSizedContainer(data, size, chunks, offsets)) {
+        if (offsets.back() > capacity) {
+            throw HuffmanError(ErrorCode::INVALID_INPUT, "Output buffer too small for the decompressed data");
+        }
+        decodeSizedChunks(chunks, offsets, dst, [](size_t) {});
+        return offsets.back();
+    }
+    // Other images decode into staging; a recorded size too large for dst is rejected first
+    uint64_t recorded = 0;
+    if (huffman::decompressedSize(data, size, recorded) && recorded > capacity) {
+        throw HuffmanError(ErrorCode::INVALID_INPUT, "Output buffer too small for the decompressed data");
+    }
+    decodeBuffer(data, size, scratch_.staging, nullptr, scratch_);
+    if (scratch_.staging.size() > capacity) {
+        throw HuffmanError(ErrorCode::INVALID_INPUT, "Output buffer too small for the decompressed data");
+    }
+    std::copy(scratch_.staging.begin(), scratch_.staging.end(), dst);
+    return scratch_.staging.size();
+}
+
+bool huffman::decompressedSize(const uint8_t* data, size_t size, uint64_t& decompressed_size) {
+    if (size >= LZV6_MAGIC_SIZE + LZV6_SIZE_FIELDS && isSizedImage(data)) {
+        decompressed_size = readLittleEndian(data + LZV6_MAGIC_SIZE, 8);
+        return true;
+    }
+    // A complete HUF_STRM stream ends with the end marker and the total size
+    if (size >= STREAM_MAGIC_SIZE + STREAM_FRAME_HEADER_SIZE + STREAM_TRAILER_SIZE &&
+        std::memcmp(data, STREAM_MAGIC, STREAM_MAGIC_SIZE) == 0) {
+        const uint8_t* end = data + size - STREAM_TRAILER_SIZE;
+        if (readLittleEndian(end - STREAM_FRAME_HEADER_SIZE, STREAM_FRAME_HEADER_SIZE) != 0) return false;
+        decompressed_size = readLittleEndian(end, 8);
+        return true;
+    }
+    std::vector<ChunkView> chunks;
+    std::vector<size_t> offsets;
+    try {
+        if (!parseSizedContainer(data, size, chunks, offsets)) return false;
+    } catch (const HuffmanError&) {
+        return false;
+    }
+    decompressed_size = offsets.back();
+    return true;
+}
+
+void huffman::StreamDecompressor::begin(StreamSink sink) {
+    sink_ = std::move(sink);
+    state_ = State::MAGIC;
+    need_ = STREAM_MAGIC_SIZE;
+    pending_.clear();
+    window_.clear();
+    total_out_ = 0;
+    crc_ = 0;
+}
+
+void huffman::StreamDecompressor::update(const uint8_t* data, size_t size) {
+    if (state_ == State::IDLE) throw HuffmanError(ErrorCode::INVALID_INPUT, "Stream decompressor was not started");
+    while (size > 0) {
+        if (state_ == State::WHOLE) {
+            pending_.insert(pending_.end(), data, data + size);
+            return;
+        }
+        if (state_ == State::DONE) throw HuffmanError(ErrorCode::CORRUPTED_HEADER, "Data after the end of the stream");
+        // Whole pieces are read in place; only one split across calls is copied
+        const uint8_t* piece;
+        if (pending_.empty() && size >= need_) {
+            piece = data;
+            data += need_;
+            size -= need_;
+        } else {
+            size_t n = std::min(size, need_ - pending_.size());
+            pending_.insert(pending_.end(), data, data + n);
+            data += n;
+            size -= n;
+            if (pending_.size() < need_) return;
+            piece = pending_.data();
+        }
+        consume(piece);
+        if (state_ == State::WHOLE) {
+            // Not a stream: keep the magic with the rest of the input
+            if (piece != pending_.data()) pending_.assign(piece, piece + STREAM_MAGIC_SIZE);
+        } else {
+            pending_.clear();
+        }
+    }
+}
+
+void huffman::StreamDecompressor::consume(const uint8_t* piece) {
+    switch (state_) {
+    case State::MAGIC:
+        if (std::memcmp(piece, STREAM_MAGIC, STREAM_MAGIC_SIZE) != 0) {
+            state_ = State::WHOLE;
+            return;
+        }
+        state_ = State::FRAME_HEADER;
+        need_ = STREAM_FRAME_HEADER_SIZE;
+        return;
+    case State::FRAME_HEADER: {
+        uint64_t blob_size = readLittleEndian(piece, STREAM_FRAME_HEADER_SIZE);
+        if (blob_size == 0) {
+            state_ = State::TRAILER;
+            need_ = STREAM_TRAILER_SIZE;
+            return;
+        }
+        // Blocks are at most STREAM_MAX_BLOCK_SIZE, which also bounds their frames
+        if (blob_size > compressBound(STREAM_MAX_BLOCK_SIZE) + 64) {
+            throw HuffmanError(ErrorCode::CORRUPTED_HEADER, "Stream frame too large");
+        }
+        state_ = State::FRAME;
+        need_ = static_cast<size_t>(blob_size);
+        return;
+    }
+    case State::FRAME: {
+        ChunkView chunk = parseChunk(piece, need_);
+        if (!chunk.hybrid || chunk.orig_size == 0 || chunk.orig_size > STREAM_MAX_BLOCK_SIZE) {
+            throw HuffmanError(ErrorCode::CORRUPTED_HEADER, "Invalid stream block");
+        }
+        const size_t history = window_.size();
+        const size_t block = static_cast<size_t>(chunk.orig_size);
+        window_.resize(history + block);
+        decodeChunkInto(chunk, window_.data() + history, history);
+        crc_ = CRC32::update(crc_, window_.data() + history, block);
+        total_out_ += block;
+        sink_(window_.data() + history, block);
+        window_.erase(window_.begin(), window_.end() - std::min<size_t>(window_.size(), LZ77::MAX_OFFSET));
+        state_ = State::FRAME_HEADER;
+        need_ = STREAM_FRAME_HEADER_SIZE;
+        return;
+    }
+    case State::TRAILER:
+        if (readLittleEndian(piece, 8) != total_out_) {
+            throw HuffmanError(ErrorCode::CORRUPTED_HEADER, "Stream size mismatch");
+        }
+        if (readLittleEndian(piece + 8, 4) != crc_) {
+            throw HuffmanError(ErrorCode::CORRUPTED_HEADER, "CRC32 mismatch: stream may be corrupted");
+        }
+        state_ = State::DONE;
+        return;
+    default:
+        return;
+    }
+}
+
+void huffman::StreamDecompressor::finish() {
+    const State state = state_;
+    state_ = State::IDLE;
+    if (state == State::DONE) return;
+    if (state != State::MAGIC && state != State::WHOLE) {
+        throw HuffmanError(ErrorCode::CORRUPTED_HEADER, state == State::IDLE ? "Stream decompressor was not started" : "Stream ended before its end marker");
+    }
+    // Collected input of another format (or too short to tell)
+    std::vector<uint8_t> input;
+    input.swap(pending_);
+    std::vector<uint8_t> window;
+    DecompressScratch scratch;
+    decodeBuffer(input.data(), input.size(), window, &sink_, scratch);
+}
+
+// readAt (see readPar2Index) over an open file
+struct FileReadAt {
+    std::ifstream& in;
+
+    bool operator()(uint64_t pos, size_t n, unsigned char* dst) const {
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(pos));
+        in.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(n));
+        return static_cast<size_t>(in.gcount()) == n;
+    }
+};
+
+// Bytes of a HUF_STRM file fed to the stream decoder at a time, and of each
+// HUF_LZV6 stream buffered while it is decoded
+static constexpr size_t FILE_READ_SIZE = 64 * 1024;
+
+// Read blobs [begin, end) of a container file
+static std::vector<unsigned char> readBlobs(const FileReadAt& readAt, uint64_t begin, uint64_t end) {
+    std::vector<unsigned char> blobs(static_cast<size_t>(end - begin));
+    if (!readAt(begin, blobs.size(), blobs.data())) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk truncated");
+    }
+    return blobs;
+}
+
+// Legacy HUF_PAR file: chunk sizes are read up front, then the blobs of one batch
+// of chunks at a time
+static void decodeParFile(uint64_t fileSize, const FileReadAt& readAt, const huffman::StreamSink& sink) {
+    const uint64_t sizesAt = 7 + sizeof(uint32_t);
+    uint32_t nChunks = 0;
+    unsigned char field[sizeof(uint32_t)];
+    if (!readAt(7, sizeof(field), field)) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read chunk count");
+    }
+    std::memcpy(&nChunks, field, sizeof(nChunks)); // native byte order, as written
+    if (nChunks > (fileSize - sizesAt) / sizeof(uint32_t)) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read chunk size");
+    }
+    std::vector<uint32_t> chunkSizes(nChunks);
+    if (!readAt(sizesAt, nChunks * sizeof(uint32_t), reinterpret_cast<unsigned char*>(chunkSizes.data()))) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read chunk size");
+    }
+
+    std::vector<unsigned char> window;
+    uint64_t blobAt = sizesAt + nChunks * sizeof(uint32_t);
+    for (size_t first = 0; first < nChunks; first += chunkBatchSize()) {
+        const size_t last = std::min<size_t>(nChunks, first + chunkBatchSize());
+        uint64_t blobEnd = blobAt;
+        for (size_t ci = first; ci < last; ++ci) blobEnd += chunkSizes[ci];
+        if (blobEnd > fileSize) {
+            throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Chunk truncated");
+        }
+        std::vector<unsigned char> blobs = readBlobs(readAt, blobAt, blobEnd);
+        std::vector<ChunkView> chunks;
+        const unsigned char* blob = blobs.data();
+        for (size_t ci = first; ci < last; ++ci) {
+            chunks.push_back(parseChunk(blob, chunkSizes[ci]));
+            blob += chunkSizes[ci];
+        }
+        blobAt = blobEnd;
+        if (std::all_of(chunks.begin(), chunks.end(), [](const ChunkView& c) { return c.has_size; })) {
+            std::vector<size_t> offsets(1, 0);
+            for (const ChunkView& chunk : chunks) appendChunkEnd(offsets, chunk);
+            decodeChunkBatch(chunks, offsets, window, sink);
+            continue;
+        }
+        // Oldest files: chunks without a size decode one at a time
+        for (const ChunkView& chunk : chunks) {
+            if (chunk.has_size) {
+                std::vector<size_t> chunkOffsets(1, 0);
+                appendChunkEnd(chunkOffsets, chunk);
+                decodeChunkBatch({chunk}, chunkOffsets, window, sink);
+            } else {
+                std::vector<unsigned char> huff_decoded = decodeUnsizedChunk(chunk);
+                sink(huff_decoded.data(), huff_decoded.size());
+                window.insert(window.end(), huff_decoded.begin(), huff_decoded.end());
+                keepHistory(window);
             }
         }
+    }
+}
 
-        std::unordered_map<std::string, unsigned char> rev_codes;
-        for (const auto& kv : codes) rev_codes[kv.second] = kv.first;
+// HUF_LZV6 file: after the header, the payload is read once in FILE_READ_SIZE
+// pieces to check its CRC32, then decoded through one refilling BitReader per stream
+static void decodeSizedFile(uint64_t fileSize, const FileReadAt& readAt, const huffman::StreamSink& sink) {
+    constexpr size_t SIZED_HEAD = huffman::LZV6_MAGIC_SIZE + huffman::LZV6_SIZE_FIELDS;
+    unsigned char head[SIZED_HEAD + LZ77::LITLEN_SYMBOLS + LZ77::DIST_SYMBOLS + sizeof(uint32_t)];
+    if (fileSize < SIZED_HEAD || !readAt(0, SIZED_HEAD, head)) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read original size");
+    }
+    const uint64_t orig_size = huffman::readLittleEndian(head + huffman::LZV6_MAGIC_SIZE, 8);
+    const uint32_t orig_crc = static_cast<uint32_t>(huffman::readLittleEndian(head + huffman::LZV6_MAGIC_SIZE + 8, 4));
+    if (orig_size == 0) {
+        if (fileSize != SIZED_HEAD) {
+            throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Data after an empty image");
+        }
+        return;
+    }
+    if (fileSize < sizeof(head) || !readAt(0, sizeof(head), head)) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Cannot read code length tables");
+    }
+    uint32_t crc_stored = 0;
+    std::memcpy(&crc_stored, head + sizeof(head) - sizeof(crc_stored), sizeof(crc_stored)); // native byte order, as written
+    const uint64_t payloadAt = sizeof(head);
+    const uint64_t payload_size = fileSize - payloadAt;
 
-        // Decode Huffman (compressed LZ77 byte stream for hybrid mode)
-        std::vector<unsigned char> decoded;
-        {
-            BitReader reader(crc_buf);
-            std::string cur;
-            while (reader.hasMoreBits()) {
-                cur.clear();
-                while (true) {
-                    if (!reader.hasMoreBits()) break;
-                    bool bit = reader.readBit();
-                    cur += bit ? '1' : '0';
-                    auto it = rev_codes.find(cur);
-                    if (it != rev_codes.end()) {
-                        decoded.push_back(it->second);
-                        break;
-                    }
-                }
+    uint32_t crc = 0;
+    std::vector<unsigned char> piece(FILE_READ_SIZE);
+    for (uint64_t pos = payloadAt; pos < fileSize; pos += piece.size()) {
+        piece.resize(static_cast<size_t>(std::min<uint64_t>(FILE_READ_SIZE, fileSize - pos)));
+        if (!readAt(pos, piece.size(), piece.data())) {
+            throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, "Compressed file ended early");
+        }
+        crc = huffman::CRC32::update(crc, piece.data(), piece.size());
+    }
+    if (crc != crc_stored) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "CRC32 mismatch: file may be corrupted");
+    }
+
+    unsigned char table[JUMP_TABLE_SIZE];
+    if (payload_size >= JUMP_TABLE_SIZE && !readAt(payloadAt, sizeof(table), table)) {
+        throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, "Compressed file ended early");
+    }
+    uint64_t sizes[STREAMS];
+    interleavedStreamSizes(table, payload_size, sizes);
+
+    huffman::DecompressScratch scratch;
+    useHybridTables(scratch, head + SIZED_HEAD, head + SIZED_HEAD + LZ77::LITLEN_SYMBOLS, payload_size);
+    scratch.readers.reserve(STREAMS);
+    uint64_t streamAt = payloadAt + JUMP_TABLE_SIZE;
+    for (unsigned s = 0; s < STREAMS; ++s) {
+        const uint64_t streamEnd = streamAt + sizes[s];
+        scratch.readers.emplace_back([&readAt, pos = streamAt, streamEnd](uint8_t* dst, size_t capacity) mutable {
+            const size_t n = static_cast<size_t>(std::min<uint64_t>(capacity, streamEnd - pos));
+            if (n > 0 && !readAt(pos, n, dst)) {
+                throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, "Compressed file ended early");
             }
+            pos += n;
+            return n;
+        }, FILE_READ_SIZE);
+        streamAt = streamEnd;
+    }
+    std::vector<unsigned char> window;
+    decodeSizedTokens(scratch, payload_size, orig_size, orig_crc, window, &sink);
+}
+
+// Decode a compressed file and send its output to sink. Streams, HUF_PAR2 and
+// HUF_PAR containers are read a frame or a batch of chunks at a time, and a
+// HUF_LZV6 file through a buffer per stream, so memory depends on the block and
+// chunk sizes rather than the file size. Older single-stream formats are read
+// whole, but their output still goes through a bounded window.
+static void decodeFile(uint64_t fileSize, const FileReadAt& readAt, const huffman::StreamSink& sink) {
+    unsigned char magic[8];
+    const size_t magic_read = static_cast<size_t>(std::min<uint64_t>(fileSize, sizeof(magic)));
+    if (!readAt(0, magic_read, magic)) {
+        throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, "Cannot read magic number");
+    }
+    const std::string magic_str(reinterpret_cast<const char*>(magic), magic_read);
+
+    if (magic_str == huffman::STREAM_MAGIC) {
+        huffman::StreamDecompressor stream;
+        stream.begin(sink);
+        std::vector<unsigned char> piece(FILE_READ_SIZE);
+        for (uint64_t pos = 0; pos < fileSize; pos += piece.size()) {
+            piece.resize(static_cast<size_t>(std::min<uint64_t>(FILE_READ_SIZE, fileSize - pos)));
+            if (!readAt(pos, piece.size(), piece.data())) {
+                throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, "Compressed file ended early");
+            }
+            stream.update(piece.data(), piece.size());
         }
+        stream.finish();
+        return;
+    }
 
-        // If this is hybrid (LZ77 + Huffman), apply LZ77 decompression
-        std::vector<unsigned char> final_output;
-        if (is_hybrid) {
-            auto tokens = LZ77::bytesToTokens(decoded);
-            final_output = LZ77::decompress(tokens);
-        } else {
-            final_output = std::move(decoded);
+    std::vector<huffman::ChunkIndexEntry> index;
+    if (magic_str == huffman::PAR2_MAGIC && readPar2Index(fileSize, readAt, index)) {
+        std::vector<unsigned char> window;
+        for (size_t first = 0; first < index.size(); first += chunkBatchSize()) {
+            const size_t last = std::min(index.size(), first + chunkBatchSize());
+            const uint64_t begin = index[first].compressed_offset;
+            std::vector<unsigned char> blobs = readBlobs(readAt, begin, index[last - 1].compressed_offset + index[last - 1].compressed_size);
+            std::vector<size_t> offsets;
+            std::vector<ChunkView> chunks = parsePar2Chunks(blobs.data(), begin, index, first, last, offsets);
+            decodeChunkBatch(chunks, offsets, window, sink);
+        }
+        return;
+    }
+    if (magic_str.rfind("HUF_PAR", 0) == 0) {
+        decodeParFile(fileSize, readAt, sink);
+        return;
+    }
+    if (magic_read == sizeof(magic) && huffman::isSizedImage(magic)) {
+        decodeSizedFile(fileSize, readAt, sink);
+        return;
+    }
+
+    // Older single-stream formats check a CRC over the whole payload before decoding
+    std::vector<unsigned char> input(static_cast<size_t>(fileSize));
+    if (!readAt(0, input.size(), input.data())) {
+        throw huffman::HuffmanError(huffman::ErrorCode::FILE_READ_ERROR, "Cannot read compressed file");
+    }
+    std::vector<unsigned char> window;
+    huffman::DecompressScratch scratch;
+    decodeBuffer(input.data(), input.size(), window, &sink, scratch);
+}
+
+bool huffman::decompressedSize(const std::string& path, uint64_t& decompressed_size) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    const uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    const FileReadAt readAt{in};
+    unsigned char head[LZV6_MAGIC_SIZE + LZV6_SIZE_FIELDS];
+    const size_t head_read = static_cast<size_t>(std::min<uint64_t>(fileSize, sizeof(head)));
+    if (head_read < 8 || !readAt(0, head_read, head)) return false;
+
+    // Single-stream and HUF_STRM images keep the size in a fixed place
+    if (isSizedImage(head)) {
+        return decompressedSize(head, head_read, decompressed_size);
+    }
+    if (std::memcmp(head, STREAM_MAGIC, STREAM_MAGIC_SIZE) == 0) {
+        const size_t tail = STREAM_FRAME_HEADER_SIZE + STREAM_TRAILER_SIZE;
+        if (fileSize < STREAM_MAGIC_SIZE + tail) return false;
+        unsigned char image[STREAM_MAGIC_SIZE + tail];
+        std::memcpy(image, head, STREAM_MAGIC_SIZE);
+        if (!readAt(fileSize - tail, tail, image + STREAM_MAGIC_SIZE)) return false;
+        return decompressedSize(image, sizeof(image), decompressed_size);
+    }
+    try {
+        // HUF_PAR2 from its index; an older HUF_PAR has the sizes in its chunk headers
+        std::vector<ChunkIndexEntry> index;
+        if (std::memcmp(head, PAR2_MAGIC, PAR2_MAGIC_SIZE) == 0 && readPar2Index(fileSize, readAt, index)) {
+            decompressed_size = index.empty() ? 0 : index.back().original_offset + index.back().original_size;
+            return true;
+        }
+        if (std::memcmp(head, "HUF_PAR", 7) == 0) {
+            std::vector<unsigned char> image(static_cast<size_t>(fileSize));
+            return readAt(0, image.size(), image.data()) && decompressedSize(image.data(), image.size(), decompressed_size);
+        }
+    } catch (const HuffmanError&) {
+        return false;
+    }
+    return false;
+}
+
+static void reportDecompressionError(const huffman::HuffmanError& e) {
+    std::cerr << "Decompression error: " << e.what() << std::endl;
+    switch (e.getCode()) {
+        case huffman::ErrorCode::FILE_NOT_FOUND:
+            std::cerr << "  Suggestion: Check the input file path and ensure the file exists." << std::endl;
+            break;
+        case huffman::ErrorCode::FILE_READ_ERROR:
+        case huffman::ErrorCode::FILE_WRITE_ERROR:
+            std::cerr << "  Suggestion: Check file permissions and disk space." << std::endl;
+            break;
+        case huffman::ErrorCode::INVALID_MAGIC:
+        case huffman::ErrorCode::CORRUPTED_HEADER:
+            std::cerr << "  Suggestion: The file may not be a valid Huffman-compressed file or is corrupted." << std::endl;
+            break;
+        case huffman::ErrorCode::DECOMPRESSION_FAILED:
+            std::cerr << "  Suggestion: Try running with verbose mode for more details." << std::endl;
+            break;
+        case huffman::ErrorCode::INVALID_INPUT:
+            std::cerr << "  Suggestion: Check input arguments and file format." << std::endl;
+            break;
+        case huffman::ErrorCode::MEMORY_ERROR:
+            std::cerr << "  Suggestion: Not enough memory. Try smaller files or close other applications." << std::endl;
+            break;
+        default:
+            break;
+    }
+}
+
+bool Decompressor::decompress(const std::vector<unsigned char>& input, std::vector<unsigned char>& output) {
+    try {
+        huffman::DecompressContext context;
+        context.decompress(input, output);
+        return true;
+    } catch (const huffman::HuffmanError& e) {
+        reportDecompressionError(e);
+    } catch (const std::exception& e) {
+        std::cerr << "Unexpected error during decompression: " << e.what() << std::endl;
+        std::cerr << "  Suggestion: Try running with verbose mode or check your input files." << std::endl;
+    }
+    output.clear();
+    return false;
+}
+
+// File wrapper around decodeFile; output is written as soon as it is final
+bool Decompressor::decompress(const std::string& inPath, const std::string& outPath) {
+    try {
+        std::ifstream in(inPath, std::ios::binary | std::ios::ate);
+        if (!in) {
+            throw huffman::HuffmanError(huffman::ErrorCode::FILE_NOT_FOUND, inPath);
         }
+        const uint64_t fileSize = static_cast<uint64_t>(in.tellg());
 
-        // Write output file
         std::ofstream out(outPath, std::ios::binary);
         if (!out) {
             throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
         }
-        out.write(reinterpret_cast<const char*>(final_output.data()), final_output.size());
+        try {
+            decodeFile(fileSize, FileReadAt{in}, [&](const uint8_t* data, size_t n) {
+                out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(n));
+                if (out.bad()) {
+                    throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
+                }
+            });
+        } catch (...) {
+            // Do not leave a partially restored file behind
+            out.close();
+            std::remove(outPath.c_str());
+            throw;
+        }
         if (out.bad()) {
             throw huffman::HuffmanError(huffman::ErrorCode::FILE_WRITE_ERROR, outPath);
         }
         return true;
     } catch (const huffman::HuffmanError& e) {
-        std::cerr << "Decompression error: " << e.what() << std::endl;
-        switch (e.getCode()) {
-            case huffman::ErrorCode::FILE_NOT_FOUND:
-                std::cerr << "  Suggestion: Check the input file path and ensure the file exists." << std::endl;
-                break;
-            case huffman::ErrorCode::FILE_READ_ERROR:
-            case huffman::ErrorCode::FILE_WRITE_ERROR:
-                std::cerr << "  Suggestion: Check file permissions and disk space." << std::endl;
-                break;
-            case huffman::ErrorCode::INVALID_MAGIC:
-            case huffman::ErrorCode::CORRUPTED_HEADER:
-                std::cerr << "  Suggestion: The file may not be a valid Huffman-compressed file or is corrupted." << std::endl;
-                break;
-            case huffman::ErrorCode::DECOMPRESSION_FAILED:
-                std::cerr << "  Suggestion: Try running with verbose mode for more details." << std::endl;
-                break;
-            case huffman::ErrorCode::INVALID_INPUT:
-                std::cerr << "  Suggestion: Check input arguments and file format." << std::endl;
-                break;
-            case huffman::ErrorCode::MEMORY_ERROR:
-                std::cerr << "  Suggestion: Not enough memory. Try smaller files or close other applications." << std::endl;
-                break;
-            default:
-                break;
-        }
+        reportDecompressionError(e);
         return false;
     } catch (const std::exception& e) {
         std::cerr << "Unexpected error during decompression: " << e.what() << std::endl;
@@ -336,3 +1420,53 @@ bool Decompressor::decompress(const std::string& inPath, const std::string& outP
         return false;
     }
 }
+
+bool Decompressor::decompressRange(const std::string& inPath, uint64_t offset, size_t length,
+                                   std::vector<unsigned char>& out) {
+    out.clear();
+    try {
+        std::ifstream in(inPath, std::ios::binary | std::ios::ate);
+        if (!in) {
+            throw huffman::HuffmanError(huffman::ErrorCode::FILE_NOT_FOUND, inPath);
+        }
+        const uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+        const FileReadAt readAt{in};
+        unsigned char magic[huffman::PAR2_MAGIC_SIZE];
+        std::vector<huffman::ChunkIndexEntry> index;
+        if (!readAt(0, sizeof(magic), magic) ||
+            std::string(reinterpret_cast<const char*>(magic), sizeof(magic)) != huffman::PAR2_MAGIC ||
+            !readPar2Index(fileSize, readAt, index)) {
+            throw huffman::HuffmanError(huffman::ErrorCode::INVALID_INPUT, "Range reads need a seekable HUF_PAR2 file");
+        }
+
+        const uint64_t total = index.empty() ? 0 : index.back().original_offset + index.back().original_size;
+        if (offset >= total || length == 0) return true;
+        const uint64_t end = offset + std::min<uint64_t>(length, total - offset);
+
+        // Chunks [first, last) overlap the range; a primed chunk needs its predecessor decoded
+        // first, back to the last unprimed one (the compressor leaves one every
+        // DICTIONARY_RESTART_CHUNKS chunks)
+        auto byEnd = [](const huffman::ChunkIndexEntry& e, uint64_t pos) { return e.original_offset + e.original_size <= pos; };
+        size_t first = std::lower_bound(index.begin(), index.end(), offset, byEnd) - index.begin();
+        size_t last = std::lower_bound(index.begin(), index.end(), end - 1, byEnd) - index.begin() + 1;
+        while (first > 0 && index[first].dict_size > 0) --first;
+
+        // Only the blobs of those chunks are read
+        const uint64_t begin = index[first].compressed_offset;
+        std::vector<unsigned char> blobs = readBlobs(readAt, begin, index[last - 1].compressed_offset + index[last - 1].compressed_size);
+        std::vector<size_t> outOffsets;
+        std::vector<ChunkView> chunks = parsePar2Chunks(blobs.data(), begin, index, first, last, outOffsets);
+        std::vector<unsigned char> decoded(outOffsets.back());
+        decodeSizedChunks(chunks, outOffsets, decoded.data(), [](size_t) {});
+
+        const size_t from = static_cast<size_t>(offset - index[first].original_offset);
+        out.assign(decoded.begin() + from, decoded.begin() + from + static_cast<size_t>(end - offset));
+        return true;
+    } catch (const huffman::HuffmanError& e) {
+        std::cerr << "Decompression error: " << e.what() << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Unexpected error during decompression: " << e.what() << std::endl;
+    }
+    out.clear();
+    return false;
+}
@@ -4,6 +4,7 @@
 #include "../include/Decompressor.h"
 #include "../include/Checksum.h"
 #include "../include/HuffmanCompressor.h"
+#include "../include/ThreadPool.h"
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -150,10 +151,14 @@ bool FolderCompressor::readArchiveHeader(std::ifstream& in,
     return in.good();
 }
 
-bool FolderCompressor::compressSingleFileToArchive(const std::string& file_path,
-                                                   std::ofstream& archive_stream,
-                                                   FileEntry& entry,
-                                                   const CompressionSettings& settings) {
+// Files handed to the pool per round; bounds how many payloads are held in memory
+static size_t folderBatchSize() {
+    return static_cast<size_t>(ThreadPool::shared().size()) * 2;
+}
+
+std::vector<uint8_t> FolderCompressor::packFileForArchive(const std::string& file_path,
+                                                          FileEntry& entry,
+                                                          const CompressionSettings& settings) {
     // Read original file
     std::ifstream input(file_path, std::ios::binary);
     if (!input) {
@@ -186,26 +191,16 @@ bool FolderCompressor::compressSingleFileToArchive(const std::string& file_path,
         // Use compressed data
         entry.is_compressed = true;
         entry.compressed_size = compressed_data.size();
-        entry.data_offset = archive_stream.tellp();
-        
-        archive_stream.write(reinterpret_cast<const char*>(compressed_data.data()), 
-                            compressed_data.size());
-    } else {
-        // Store uncompressed (better than expanding the file!)
-        entry.is_compressed = false;
-        entry.compressed_size = original_data.size();
-        entry.data_offset = archive_stream.tellp();
-        
-        archive_stream.write(reinterpret_cast<const char*>(original_data.data()), 
-                            original_data.size());
+        return compressed_data;
     }
-    
-    return archive_stream.good();
+    // Store uncompressed (better than expanding the file!)
+    entry.is_compressed = false;
+    entry.compressed_size = original_data.size();
+    return original_data;
 }
 
-bool FolderCompressor::decompressSingleFileFromArchive(std::ifstream& archive_stream,
-                                                       const FileEntry& entry,
-                                                       const std::string& output_path) {
+std::vector<uint8_t> FolderCompressor::readFileFromArchive(std::ifstream& archive_stream,
+                                                          const FileEntry& entry) {
     // Seek to data position
     archive_stream.seekg(entry.data_offset);
     
@@ -217,7 +212,12 @@ bool FolderCompressor::decompressSingleFileFromArchive(std::ifstream& archive_st
     if (!archive_stream.good()) {
         throw HuffmanError(ErrorCode::FILE_READ_ERROR, "Failed to read data");
     }
-    
+    return file_data;
+}
+
+bool FolderCompressor::restoreFileFromArchive(std::vector<uint8_t>& file_data,
+                                              const FileEntry& entry,
+                                              const std::string& output_path) {
     std::vector<uint8_t> decompressed_data;
     
     if (entry.is_compressed) {
@@ -233,9 +233,6 @@ bool FolderCompressor::decompressSingleFileFromArchive(std::ifstream& archive_st
         decompressed_data = std::move(file_data);
     }
     
-    
-    createDirectoryRecursive(output_path);
-    
     // Write decompressed data
     std::ofstream output(output_path, std::ios::binary);
     if (!output) {
@@ -291,15 +288,31 @@ bool FolderCompressor::compressFolder(const std::string& folder_path,
         uint64_t total_original = 0;
         uint64_t total_compressed = 0;
         
-        for (size_t i = 0; i < files.size(); ++i) {
-            if (progress_callback_) {
-                progress_callback_(i, files.size(), metadata.files[i].relative_path);
-            }
+        // Files of a batch are compressed in parallel, then appended in order
+        const size_t batch = folderBatchSize();
+        std::vector<std::vector<uint8_t>> payloads;
+        for (size_t first = 0; first < files.size(); first += batch) {
+            size_t count = std::min(batch, files.size() - first);
+            payloads.assign(count, {});
+            ThreadPool::shared().parallelFor(count, settings.threads, [&](size_t k) {
+                payloads[k] = packFileForArchive(files[first + k], metadata.files[first + k], settings);
+            });
             
-            compressSingleFileToArchive(files[i], archive, metadata.files[i], settings);
-            
-            total_original += metadata.files[i].original_size;
-            total_compressed += metadata.files[i].compressed_size;
+            for (size_t k = 0; k < count; ++k) {
+                size_t i = first + k;
+                if (progress_callback_) {
+                    progress_callback_(i, files.size(), metadata.files[i].relative_path);
+                }
+                
+                metadata.files[i].data_offset = archive.tellp();
+                archive.write(reinterpret_cast<const char*>(payloads[k].data()), payloads[k].size());
+                if (!archive.good()) {
+                    throw HuffmanError(ErrorCode::FILE_WRITE_ERROR, "Cannot write archive: " + archive_path);
+                }
+                
+                total_original += metadata.files[i].original_size;
+                total_compressed += metadata.files[i].compressed_size;
+            }
         }
         
         // Update header with totals
@@ -343,16 +356,30 @@ bool FolderCompressor::decompressArchive(const std::string& archive_path,
         // Create output folder
         fs::create_directories(output_folder);
         
-        // Extract each file
-        for (size_t i = 0; i < metadata.files.size(); ++i) {
-            const auto& entry = metadata.files[i];
-            
-            if (progress_callback_) {
-                progress_callback_(i, metadata.files.size(), entry.relative_path);
+        // Extract each file: a batch is read in order, then decompressed and written in parallel
+        const size_t batch = folderBatchSize();
+        std::vector<std::vector<uint8_t>> payloads;
+        std::vector<std::string> output_paths;
+        for (size_t first = 0; first < metadata.files.size(); first += batch) {
+            size_t count = std::min(batch, metadata.files.size() - first);
+            payloads.assign(count, {});
+            output_paths.assign(count, {});
+            for (size_t k = 0; k < count; ++k) {
+                size_t i = first + k;
+                const auto& entry = metadata.files[i];
+                
+                if (progress_callback_) {
+                    progress_callback_(i, metadata.files.size(), entry.relative_path);
+                }
+                
+                payloads[k] = readFileFromArchive(archive, entry);
+                output_paths[k] = (fs::path(output_folder) / entry.relative_path).string();
+                createDirectoryRecursive(output_paths[k]);
             }
             
-            std::string output_path = (fs::path(output_folder) / entry.relative_path).string();
-            decompressSingleFileFromArchive(archive, entry, output_path);
+            ThreadPool::shared().parallelFor(count, 0, [&](size_t k) {
+                restoreFileFromArchive(payloads[k], metadata.files[first + k], output_paths[k]);
+            });
         }
         
         archive.close();
@@ -1,59 +1,42 @@
 #include "../include/HuffmanCompressor.h"
 #include "../include/Compressor.h"
 #include "../include/Decompressor.h"
-#include "../include/Checksum.h"
+#include "../include/StreamCodec.h"
 #include <fstream>
 #include <chrono>
-#include <sstream>
 
 namespace huffman {
 
+// Input is pushed through the stream codecs in pieces of this size
+static const size_t STREAM_READ_SIZE = 64 * 1024;
+
 CompressionResult compress(std::istream& in, std::ostream& out, const CompressionSettings& settings) {
     CompressionResult result;
     auto start = std::chrono::high_resolution_clock::now();
     
     try {
-        // Read input data
-        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-        result.original_size = data.size();
-        result.original_checksum = CRC32::calculate(data);
-        
-        if (data.empty()) {
-            // Handle empty input
-            out.write("HUF1", 4);
-            uint16_t table_size = 0;
-            out.write(reinterpret_cast<const char*>(&table_size), sizeof(table_size));
-            result.success = true;
-            result.compressed_size = 6;
-            return result;
+        // Blocks are written as soon as they are compressed, so memory stays flat
+        StreamCompressor stream;
+        stream.begin([&](const uint8_t* data, size_t size) {
+            out.write(reinterpret_cast<const char*>(data), size);
+            result.compressed_size += size;
+        }, settings);
+        std::vector<char> buffer(STREAM_READ_SIZE);
+        while (in) {
+            in.read(buffer.data(), buffer.size());
+            stream.update(reinterpret_cast<const uint8_t*>(buffer.data()), static_cast<size_t>(in.gcount()));
         }
-        
-        // Write to temporary file and use existing compressor
-        std::ofstream temp_in("temp_lib_input.txt", std::ios::binary);
-        temp_in.write(reinterpret_cast<const char*>(data.data()), data.size());
-        temp_in.close();
-        
-        Compressor comp;
-        bool success = comp.compress("temp_lib_input.txt", "temp_lib_compressed.huf", settings);
-        
-        if (!success) {
-            result.error = "Compression failed";
-            return result;
+        if (in.bad()) {
+            throw HuffmanError(ErrorCode::FILE_READ_ERROR, "input stream");
         }
-        
-        // Read compressed data and write to output stream
-        std::ifstream compressed_file("temp_lib_compressed.huf", std::ios::binary);
-        std::vector<uint8_t> compressed_data((std::istreambuf_iterator<char>(compressed_file)), std::istreambuf_iterator<char>());
-        compressed_file.close();
-        
-        out.write(reinterpret_cast<const char*>(compressed_data.data()), compressed_data.size());
-        result.compressed_size = compressed_data.size();
+        stream.finish();
+        if (!out) {
+            throw HuffmanError(ErrorCode::FILE_WRITE_ERROR, "output stream");
+        }
+        result.original_size = stream.totalIn();
+        result.original_checksum = stream.checksum();
         result.success = true;
         
-        // Clean up
-        std::remove("temp_lib_input.txt");
-        std::remove("temp_lib_compressed.huf");
-        
     } catch (const std::exception& e) {
         result.error = e.what();
         result.success = false;
@@ -71,36 +54,27 @@ CompressionResult decompress(std::istream& in, std::ostream& out) {
     auto start = std::chrono::high_resolution_clock::now();
     
     try {
-        // Read compressed data
-        std::vector<uint8_t> compressed_data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-        result.compressed_size = compressed_data.size();
-        
-        // Write to temporary file and use existing decompressor
-        std::ofstream temp_compressed("temp_lib_compressed.huf", std::ios::binary);
-        temp_compressed.write(reinterpret_cast<const char*>(compressed_data.data()), compressed_data.size());
-        temp_compressed.close();
-        
-        Decompressor decomp;
-        bool success = decomp.decompress("temp_lib_compressed.huf", "temp_lib_output.txt");
-        
-        if (!success) {
-            result.error = "Decompression failed";
-            return result;
+        StreamDecompressor stream;
+        stream.begin([&](const uint8_t* data, size_t size) {
+            out.write(reinterpret_cast<const char*>(data), size);
+            result.original_size += size;
+        });
+        std::vector<char> buffer(STREAM_READ_SIZE);
+        while (in) {
+            in.read(buffer.data(), buffer.size());
+            size_t n = static_cast<size_t>(in.gcount());
+            stream.update(reinterpret_cast<const uint8_t*>(buffer.data()), n);
+            result.compressed_size += n;
+        }
+        if (in.bad()) {
+            throw HuffmanError(ErrorCode::FILE_READ_ERROR, "input stream");
+        }
+        stream.finish();
+        if (!out) {
+            throw HuffmanError(ErrorCode::FILE_WRITE_ERROR, "output stream");
         }
-        
-        // Read decompressed data and write to output stream
-        std::ifstream output_file("temp_lib_output.txt", std::ios::binary);
-        std::vector<uint8_t> data((std::istreambuf_iterator<char>(output_file)), std::istreambuf_iterator<char>());
-        output_file.close();
-        
-        out.write(reinterpret_cast<const char*>(data.data()), data.size());
-        result.original_size = data.size();
         result.success = true;
         
-        // Clean up
-        std::remove("temp_lib_compressed.huf");
-        std::remove("temp_lib_output.txt");
-        
     } catch (const std::exception& e) {
         result.error = e.what();
         result.success = false;
@@ -113,49 +87,53 @@ CompressionResult decompress(std::istream& in, std::ostream& out) {
 }
 
 std::vector<uint8_t> compressBuffer(const std::vector<uint8_t>& in, const CompressionSettings& settings) {
-    std::stringstream input_stream(std::ios::in | std::ios::out | std::ios::binary);
-    input_stream.write(reinterpret_cast<const char*>(in.data()), in.size());
-    
-    std::stringstream output_stream(std::ios::in | std::ios::out | std::ios::binary);
-    
-    auto result = compress(input_stream, output_stream, settings);
-    if (!result.success) {
+    Compressor comp;
+    std::vector<uint8_t> compressed_data;
+    if (!comp.compress(in, compressed_data, settings)) {
         return {};
     }
-    
-    std::vector<uint8_t> compressed_data;
-    output_stream.seekg(0, std::ios::end);
-    size_t size = output_stream.tellg();
-    output_stream.seekg(0, std::ios::beg);
-    
-    compressed_data.resize(size);
-    output_stream.read(reinterpret_cast<char*>(compressed_data.data()), size);
-    
     return compressed_data;
 }
 
 std::vector<uint8_t> decompressBuffer(const std::vector<uint8_t>& in) {
-    std::stringstream input_stream(std::ios::in | std::ios::out | std::ios::binary);
-    input_stream.write(reinterpret_cast<const char*>(in.data()), in.size());
-    
-    std::stringstream output_stream(std::ios::in | std::ios::out | std::ios::binary);
-    
-    auto result = decompress(input_stream, output_stream);
-    if (!result.success) {
+    Decompressor decomp;
+    std::vector<uint8_t> decompressed_data;
+    if (!decomp.decompress(in, decompressed_data)) {
         return {};
     }
-    
-    std::vector<uint8_t> decompressed_data;
-    output_stream.seekg(0, std::ios::end);
-    size_t size = output_stream.tellg();
-    output_stream.seekg(0, std::ios::beg);
-    
-    decompressed_data.resize(size);
-    output_stream.read(reinterpret_cast<char*>(decompressed_data.data()), size);
-    
     return decompressed_data;
 }
 
+size_t compressInto(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity, const CompressionSettings& settings) {
+    try {
+        CompressContext context(settings);
+        return context.compressInto(src, size, dst, capacity);
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+size_t decompressInto(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+    try {
+        DecompressContext context;
+        return context.decompressInto(src, size, dst, capacity);
+    } catch (const std::exception&) {
+        return DECOMPRESS_ERROR;
+    }
+}
+
+uint64_t getDecompressedSize(const uint8_t* src, size_t size) {
+    uint64_t decompressed_size = 0;
+    if (!decompressedSize(src, size, decompressed_size)) return SIZE_UNKNOWN;
+    return decompressed_size;
+}
+
+uint64_t getDecompressedSize(const std::string& path) {
+    uint64_t decompressed_size = 0;
+    if (!decompressedSize(path, decompressed_size)) return SIZE_UNKNOWN;
+    return decompressed_size;
+}
+
 CompressionResult compressFile(const std::string& inPath, const std::string& outPath, const CompressionSettings& settings) {
     CompressionResult result;
     auto start = std::chrono::high_resolution_clock::now();
@@ -231,6 +209,13 @@ CompressionResult decompressFile(const std::string& inPath, const std::string& o
     return result;
 }
 
+std::vector<uint8_t> decompressRange(const std::string& path, uint64_t offset, size_t length) {
+    std::vector<uint8_t> data;
+    Decompressor decomp;
+    if (!decomp.decompressRange(path, offset, length, data)) return {};
+    return data;
+}
+
 bool isValidCompressedFile(const std::string& path) {
     std::ifstream file(path, std::ios::binary);
     if (!file) return false;
@@ -246,12 +231,17 @@ bool isValidCompressedFile(const std::string& path) {
     // Accept any known magic/header variants produced by the compressor:
     // - legacy single-chunk empty file: "HUF1"
     // - legacy huffman: "HUF2"
-    // - hybrid (LZ77 + Huffman): "HUF_LZ77"
-    // - parallel container: "HUF_PAR"
+    // - hybrid (LZ77 + Huffman): "HUF_LZ77" (legacy), "HUF_LZV6" (DEFLATE-style
+    //   literal/length + distance alphabets over 4 interleaved bitstreams, with the
+    //   original size and CRC32 in the header)
+    // - parallel container: "HUF_PAR", "HUF_PAR2" (seekable, with a trailing chunk index)
+    // - framed stream: "HUF_STRM" (written block by block by StreamCompressor)
     if (header.rfind("HUF1", 0) == 0) return true;
     if (header.rfind("HUF2", 0) == 0) return true;
     if (header.rfind("HUF_LZ77", 0) == 0) return true;
+    if (header.rfind("HUF_LZV6", 0) == 0) return true;
     if (header.rfind("HUF_PAR", 0) == 0) return true;
+    if (header.rfind("HUF_STRM", 0) == 0) return true;
 
     return false;
 }
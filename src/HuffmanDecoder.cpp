@@ -0,0 +1,88 @@
+#include "../include/HuffmanDecoder.h"
+#include "../include/HuffmanTree.h"
+#include "../include/ErrorHandler.h"
+#include <algorithm>
+
+HuffmanDecoder::HuffmanDecoder(const std::vector<uint8_t>& code_lengths) {
+    build(code_lengths);
+}
+
+void HuffmanDecoder::build(const std::vector<uint8_t>& code_lengths) {
+    max_length_ = 0;
+    for (uint8_t len : code_lengths) max_length_ = std::max<unsigned>(max_length_, len);
+    if (max_length_ > 32) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Huffman code length exceeds 32 bits");
+    }
+    // A damaged table can claim more codes than fit, which would index past the tables
+    uint64_t kraft = 0;
+    for (uint8_t len : code_lengths) {
+        if (len) kraft += uint64_t(1) << (32 - len);
+    }
+    if (kraft > (uint64_t(1) << 32)) {
+        throw huffman::HuffmanError(huffman::ErrorCode::CORRUPTED_HEADER, "Huffman code lengths are oversubscribed");
+    }
+    primary_bits_ = std::min(max_length_, PRIMARY_BITS);
+    multi_.clear();
+    const size_t primary_size = size_t(1) << primary_bits_;
+    table_.assign(primary_size, Entry());
+    if (max_length_ == 0) return;
+
+    std::vector<uint32_t> codes = HuffmanTree::canonicalCodes(code_lengths);
+
+    // Short codes fill every primary slot that starts with them
+    for (size_t sym = 0; sym < code_lengths.size(); ++sym) {
+        unsigned len = code_lengths[sym];
+        if (len == 0 || len > primary_bits_) continue;
+        size_t first = size_t(codes[sym]) << (primary_bits_ - len);
+        size_t count = size_t(1) << (primary_bits_ - len);
+        for (size_t i = 0; i < count; ++i) {
+            table_[first + i].value = static_cast<uint32_t>(sym);
+            table_[first + i].length = static_cast<uint8_t>(len);
+        }
+    }
+    if (max_length_ <= primary_bits_) return;
+
+    // Long codes: size each secondary table by the longest code behind its prefix
+    for (size_t sym = 0; sym < code_lengths.size(); ++sym) {
+        unsigned len = code_lengths[sym];
+        if (len <= primary_bits_) continue;
+        Entry& link = table_[codes[sym] >> (len - primary_bits_)];
+        link.sub_bits = std::max<uint8_t>(link.sub_bits, static_cast<uint8_t>(len - primary_bits_));
+    }
+    for (size_t i = 0; i < primary_size; ++i) {
+        if (table_[i].sub_bits == 0) continue;
+        table_[i].value = static_cast<uint32_t>(table_.size());
+        table_.resize(table_.size() + (size_t(1) << table_[i].sub_bits));
+    }
+    for (size_t sym = 0; sym < code_lengths.size(); ++sym) {
+        unsigned len = code_lengths[sym];
+        if (len <= primary_bits_) continue;
+        const Entry link = table_[codes[sym] >> (len - primary_bits_)];
+        unsigned tail = len - primary_bits_;
+        size_t low = codes[sym] & ((uint32_t(1) << tail) - 1);
+        size_t first = link.value + (low << (link.sub_bits - tail));
+        size_t count = size_t(1) << (link.sub_bits - tail);
+        for (size_t i = 0; i < count; ++i) {
+            table_[first + i].value = static_cast<uint32_t>(sym);
+            table_[first + i].length = static_cast<uint8_t>(len);
+        }
+    }
+}
+
+void HuffmanDecoder::buildMultiSymbol() {
+    multi_.assign(size_t(1) << primary_bits_, 0);
+    if (max_length_ == 0) return;
+    const size_t mask = (size_t(1) << primary_bits_) - 1;
+    for (size_t index = 0; index <= mask; ++index) {
+        uint32_t symbols = 0;
+        unsigned count = 0, used = 0;
+        // Only the first primary_bits_ - used bits after the codes so far are known
+        while (count < MAX_LITERALS) {
+            const Entry& e = table_[(index << used) & mask];
+            if (e.length == 0 || e.length > primary_bits_ - used || e.value >= 256) break;
+            symbols |= e.value << (8 * count++);
+            used += e.length;
+        }
+        multi_[index] = symbols | (uint32_t(used) << 24) | (uint32_t(count) << 28);
+    }
+}
@@ -1,50 +1,63 @@
 #include "../include/HuffmanTree.h"
-#include <queue>
 #include <algorithm>
 #include <sstream>
 
-void HuffmanTree::build(const unordered_map<unsigned char, uint64_t>& freq) {
-    struct NodeCmp {
-        bool operator()(const shared_ptr<HuffmanNode>& a, const shared_ptr<HuffmanNode>& b) const {
-            if (a->freq != b->freq) return a->freq > b->freq;
-            // break ties by symbol value (lowest byte first)
-            return a->byte > b->byte;
-        }
-    };
-    priority_queue<shared_ptr<HuffmanNode>, vector<shared_ptr<HuffmanNode>>, NodeCmp> pq;
-    for (const auto& kv : freq) {
-        pq.push(make_shared<HuffmanNode>(kv.first, kv.second));
-    }
-    while (pq.size() > 1) {
-        auto left = pq.top(); pq.pop();
-        auto right = pq.top(); pq.pop();
-        // For deterministic parent, use min byte from children
-        unsigned char parent_byte = std::min(left->byte, right->byte);
-        auto parent = make_shared<HuffmanNode>(parent_byte, left->freq + right->freq);
-        parent->left = left;
-        parent->right = right;
-        pq.push(parent);
-    }
-    root = pq.empty() ? nullptr : pq.top();
+void HuffmanTree::build(const unordered_map<unsigned char, uint64_t>& freq, unsigned max_length) {
+    vector<uint64_t> counts(256, 0);
+    for (const auto& kv : freq) counts[kv.first] = kv.second;
+    build(counts, max_length);
+}
+
+void HuffmanTree::build(const vector<uint64_t>& freq, unsigned max_length) {
+    freq_.assign(256, 0);
+    std::copy_n(freq.begin(), std::min<size_t>(freq.size(), 256), freq_.begin());
+    lengths_ = buildLengths(freq_, max_length);
+    root = nullptr;
 }
 
 HuffmanTree::CodeTable HuffmanTree::getCodes() const {
-    CodeTable table;
-    buildCodes(root, "", table);
-    return table;
+    return getCanonicalCodes();
 }
 
-void HuffmanTree::buildCodes(const shared_ptr<HuffmanNode>& node, const string& prefix, CodeTable& table) const {
+shared_ptr<HuffmanNode> HuffmanTree::explicitTree() const {
+    if (root || lengths_.empty()) return root;
+    CodeArray codes = getCodeArray();
+    vector<int> used;
+    for (int sym = 0; sym < 256; ++sym) {
+        if (codes[sym].length) used.push_back(sym);
+    }
+    auto freqOf = [&](int sym) { return freq_.empty() ? 0 : freq_[sym]; };
+    if (used.empty()) return nullptr;
+    // A lone symbol is a bare leaf, as it was before code "0" was assigned to it
+    if (used.size() == 1) return make_shared<HuffmanNode>(static_cast<unsigned char>(used[0]), freqOf(used[0]));
+
+    auto top = make_shared<HuffmanNode>(0, 0);
+    for (int sym : used) {
+        const Code& c = codes[sym];
+        uint64_t f = freqOf(sym);
+        HuffmanNode* node = top.get();
+        node->freq += f;
+        for (int b = c.length - 1; b >= 0; --b) {
+            shared_ptr<HuffmanNode>& child = ((c.code >> b) & 1) ? node->right : node->left;
+            if (!child) child = make_shared<HuffmanNode>(static_cast<unsigned char>(sym), 0);
+            child->freq += f;
+            node = child.get();
+        }
+    }
+    return top;
+}
+
+// Collect code lengths from an explicit tree (used after deserialize)
+static void collectLengths(const shared_ptr<HuffmanNode>& node, uint8_t depth, vector<uint8_t>& lengths) {
     if (!node) return;
     if (!node->left && !node->right) {
-        table[node->byte] = prefix.empty() ? "0" : prefix;
+        lengths[node->byte] = depth == 0 ? 1 : depth;
         return;
     }
-    buildCodes(node->left, prefix + "0", table);
-    buildCodes(node->right, prefix + "1", table);
+    collectLengths(node->left, depth + 1, lengths);
+    collectLengths(node->right, depth + 1, lengths);
 }
 
-
 // Helper for serialize
 static void serializeNode(const shared_ptr<HuffmanNode>& node, vector<unsigned char>& out) {
     if (!node) return;
@@ -60,7 +73,7 @@ static void serializeNode(const shared_ptr<HuffmanNode>& node, vector<unsigned c
 
 vector<unsigned char> HuffmanTree::serialize() const {
     vector<unsigned char> out;
-    serializeNode(root, out);
+    serializeNode(explicitTree(), out);
     return out;
 }
 
@@ -92,6 +105,9 @@ static shared_ptr<HuffmanNode> deserializeNode(const vector<unsigned char>& data
 void HuffmanTree::deserialize(const vector<unsigned char>& data) {
     size_t pos = 0;
     root = deserializeNode(data, pos);
+    freq_.clear();
+    lengths_.assign(256, 0);
+    collectLengths(root, 0, lengths_);
 }
 
 // Helper for DOT output - escape characters safely for Graphviz labels
@@ -132,6 +148,7 @@ static void toDotNode(const shared_ptr<HuffmanNode>& node, std::ostream& out, st
 }
 
 std::string HuffmanTree::toDot() const {
+    shared_ptr<HuffmanNode> root = explicitTree();
     if (!root) return "digraph HuffmanTree{}\n";
     std::ostringstream out;
     out << "digraph HuffmanTree {\n";
@@ -144,42 +161,171 @@ std::string HuffmanTree::toDot() const {
 
 HuffmanTree::CodeLenTable HuffmanTree::getCodeLengths() const {
     CodeLenTable lens;
-    if (!root) return lens;
-    CodeTable codes = getCodes();
-    for (const auto& kv : codes) {
-        lens[kv.first] = static_cast<int>(kv.second.size());
+    for (size_t sym = 0; sym < lengths_.size(); ++sym) {
+        if (lengths_[sym]) lens[static_cast<unsigned char>(sym)] = lengths_[sym];
     }
     return lens;
 }
 
 HuffmanTree::CodeTable HuffmanTree::getCanonicalCodes() const {
     CodeTable result;
-    auto lens = getCodeLengths();
-    if (lens.empty()) return result;
-
-    // Build list sorted by length then symbol
-    std::vector<std::pair<unsigned char, int>> items;
-    for (const auto& kv : lens) items.push_back(kv);
-    std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) {
-        if (a.second != b.second) return a.second < b.second;
-        return a.first < b.first;
-    });
-
-    // Assign canonical codes
-    unsigned int code = 0;
-    int prev_len = items.front().second;
-    for (size_t i = 0; i < items.size(); ++i) {
-        int len = items[i].second;
-        if (i > 0) {
-            ++code;
-            if (len > prev_len) code <<= (len - prev_len);
-        }
-        prev_len = len;
-        // Compute bitstring of length `len` from `code`
+    CodeArray codes = getCodeArray();
+    for (int sym = 0; sym < 256; ++sym) {
+        const Code& c = codes[sym];
+        if (c.length == 0) continue;
         std::string bits;
-        for (int b = len - 1; b >= 0; --b) bits.push_back(((code >> b) & 1) ? '1' : '0');
-        result[items[i].first] = bits;
+        for (int b = c.length - 1; b >= 0; --b) bits.push_back(((c.code >> b) & 1) ? '1' : '0');
+        result[static_cast<unsigned char>(sym)] = bits;
     }
+    return result;
+}
 
+HuffmanTree::CodeArray HuffmanTree::getCodeArray() const {
+    CodeArray result{};
+    if (lengths_.empty()) return result;
+    vector<uint32_t> codes = canonicalCodes(lengths_);
+    for (int sym = 0; sym < 256; ++sym) {
+        result[sym].code = codes[sym];
+        result[sym].length = lengths_[sym];
+    }
     return result;
 }
+
+// In-place minimum-redundancy code lengths (Moffat & Katajainen, 1995).
+// A holds n >= 2 frequencies in ascending order; on return A[i] is the code
+// length of the i-th symbol. The first pass overwrites A with the merged
+// weights and parent pointers, the second turns parents into depths, and the
+// third hands out leaf depths level by level.
+static void minimumRedundancyLengths(vector<uint64_t>& A) {
+    const size_t n = A.size();
+    size_t root = 0, leaf = 2;
+    A[0] += A[1];
+    for (size_t next = 1; next < n - 1; ++next) {
+        if (leaf >= n || A[root] < A[leaf]) {
+            A[next] = A[root];
+            A[root++] = next;
+        } else {
+            A[next] = A[leaf++];
+        }
+        if (leaf >= n || (root < next && A[root] < A[leaf])) {
+            A[next] += A[root];
+            A[root++] = next;
+        } else {
+            A[next] += A[leaf++];
+        }
+    }
+    A[n - 2] = 0;
+    for (size_t next = n - 2; next-- > 0;) A[next] = A[A[next]] + 1;
+
+    size_t avbl = 1, used = 0, next = n;
+    uint64_t depth = 0;
+    ptrdiff_t internal = static_cast<ptrdiff_t>(n) - 2;
+    while (avbl > 0) {
+        while (internal >= 0 && A[internal] == depth) { ++used; --internal; }
+        while (avbl > used) { A[--next] = depth; --avbl; }
+        avbl = 2 * used;
+        ++depth;
+        used = 0;
+    }
+}
+
+// Length-limited code lengths by package-merge (Larmore & Hirschberg, 1990).
+// w holds n >= 2 ascending weights and 2^limit >= n. Each of the limit - 1
+// rounds pairs up the previous list into packages and merges them with the
+// leaves; the cheapest 2n - 2 items of the last list are the chosen coins,
+// and a symbol's code length is the number of chosen coins containing it.
+static vector<uint8_t> packageMergeLengths(const vector<uint64_t>& w, unsigned limit) {
+    const size_t n = w.size();
+    struct Item {
+        uint64_t weight;
+        int32_t left, right; // children for packages; left = symbol, right = -1 for leaves
+    };
+    vector<Item> pool;
+    pool.reserve(n * 2 * limit);
+    for (size_t i = 0; i < n; ++i) pool.push_back({w[i], static_cast<int32_t>(i), -1});
+
+    vector<int32_t> list(n);
+    for (size_t i = 0; i < n; ++i) list[i] = static_cast<int32_t>(i);
+    for (unsigned round = 1; round < limit; ++round) {
+        vector<int32_t> merged;
+        merged.reserve(n + list.size() / 2);
+        size_t leaf = 0, pkg = 0;
+        while (leaf < n || pkg + 1 < list.size()) {
+            uint64_t pkg_weight = pkg + 1 < list.size() ? pool[list[pkg]].weight + pool[list[pkg + 1]].weight : UINT64_MAX;
+            if (leaf < n && (pkg + 1 >= list.size() || w[leaf] <= pkg_weight)) {
+                merged.push_back(static_cast<int32_t>(leaf++));
+            } else {
+                pool.push_back({pkg_weight, list[pkg], list[pkg + 1]});
+                merged.push_back(static_cast<int32_t>(pool.size() - 1));
+                pkg += 2;
+            }
+        }
+        list.swap(merged);
+    }
+
+    vector<uint8_t> lengths(n, 0);
+    vector<int32_t> stack;
+    for (size_t i = 0; i < 2 * n - 2; ++i) {
+        stack.push_back(list[i]);
+        while (!stack.empty()) {
+            const Item& item = pool[stack.back()];
+            stack.pop_back();
+            if (item.right < 0) {
+                lengths[item.left]++;
+            } else {
+                stack.push_back(item.left);
+                stack.push_back(item.right);
+            }
+        }
+    }
+    return lengths;
+}
+
+vector<uint8_t> HuffmanTree::buildLengths(const vector<uint64_t>& freq, unsigned max_length) {
+    vector<uint8_t> lengths(freq.size(), 0);
+    vector<uint32_t> symbols;
+    for (size_t i = 0; i < freq.size(); ++i) {
+        if (freq[i] > 0) symbols.push_back(static_cast<uint32_t>(i));
+    }
+    if (symbols.empty()) return lengths;
+    if (symbols.size() == 1) {
+        lengths[symbols[0]] = 1;
+        return lengths;
+    }
+    std::sort(symbols.begin(), symbols.end(), [&](uint32_t a, uint32_t b) {
+        if (freq[a] != freq[b]) return freq[a] < freq[b];
+        return a < b;
+    });
+    vector<uint64_t> A(symbols.size());
+    for (size_t i = 0; i < symbols.size(); ++i) A[i] = freq[symbols[i]];
+    minimumRedundancyLengths(A);
+    // A is non-increasing, so A[0] is the longest code
+    if (A[0] > max_length) {
+        unsigned limit = std::max(max_length, 1u);
+        while ((uint64_t(1) << limit) < symbols.size()) ++limit;
+        for (size_t i = 0; i < symbols.size(); ++i) A[i] = freq[symbols[i]];
+        vector<uint8_t> limited = packageMergeLengths(A, limit);
+        for (size_t i = 0; i < symbols.size(); ++i) A[i] = limited[i];
+    }
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        lengths[symbols[i]] = static_cast<uint8_t>(A[i]);
+    }
+    return lengths;
+}
+
+vector<uint32_t> HuffmanTree::canonicalCodes(const vector<uint8_t>& lengths) {
+    vector<uint32_t> codes(lengths.size(), 0);
+    unsigned max_len = 0;
+    for (uint8_t len : lengths) max_len = std::max<unsigned>(max_len, len);
+    vector<uint32_t> count(max_len + 1, 0), next(max_len + 2, 0);
+    for (uint8_t len : lengths) if (len) count[len]++;
+    uint32_t code = 0;
+    for (unsigned len = 1; len <= max_len; ++len) {
+        code = (code + count[len - 1]) << 1;
+        next[len] = code;
+    }
+    for (size_t sym = 0; sym < lengths.size(); ++sym) {
+        if (lengths[sym]) codes[sym] = next[lengths[sym]]++;
+    }
+    return codes;
+}
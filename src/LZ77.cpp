@@ -1,60 +1,326 @@
 #include "../include/LZ77.h"
 #include <algorithm>
+#include <cstring>
 
-std::vector<LZ77::Token> LZ77::compress(const std::vector<uint8_t>& data, size_t window, size_t lookahead) {
+namespace {
+
+constexpr unsigned HASH_BITS = 15;
+constexpr uint32_t NIL = 0xFFFFFFFFu;
+// Positions the optimal parse settles at a time, like LZMA's optimum buffer
+constexpr size_t OPTIMUM_WINDOW = 4096;
+
+// Multiplicative hash over the next MIN_MATCH bytes
+inline uint32_t hashPrefix(const uint8_t* p) {
+    uint32_t v = (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2];
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Binary-tree match finder: each hash bucket holds a binary search tree of earlier
+// positions ordered by the bytes that follow them, so one walk from the bucket
+// head yields every useful match length together with the nearest offset for it.
+class BinaryTreeMatchFinder {
+public:
+    BinaryTreeMatchFinder(const uint8_t* data, size_t window, size_t max_depth)
+        : data_(data), window_(window), cyclic_(window + 1),
+          max_depth_(max_depth), head_(size_t(1) << HASH_BITS, NIL), son_(2 * (window + 1), NIL) {}
+
+    // Appends matches at pos with strictly increasing lengths (each at least MIN_MATCH,
+    // at most len_limit) and inserts pos into the tree. Requires pos + len_limit <= size.
+    void findAndInsert(size_t pos, size_t len_limit, std::vector<LZ77::Match>& out) {
+        const uint8_t* cur = data_ + pos;
+        uint32_t h = hashPrefix(cur);
+        uint32_t cur_match = head_[h];
+        head_[h] = static_cast<uint32_t>(pos);
+
+        size_t cyclic_pos = pos % cyclic_;
+        uint32_t* ptr0 = &son_[2 * cyclic_pos + 1];
+        uint32_t* ptr1 = &son_[2 * cyclic_pos];
+        size_t len0 = 0, len1 = 0, best = 0;
+        size_t depth = max_depth_;
+        while (true) {
+            if (cur_match == NIL || pos - cur_match > window_ || depth-- == 0) {
+                *ptr0 = *ptr1 = NIL;
+                return;
+            }
+            size_t delta = pos - cur_match;
+            uint32_t* pair = &son_[2 * (cur_match % cyclic_)];
+            const uint8_t* pb = data_ + cur_match;
+            size_t len = std::min(len0, len1);
+            if (pb[len] == cur[len]) {
+                while (++len != len_limit && pb[len] == cur[len]) {}
+                if (len > best) {
+                    best = len;
+                    if (len >= LZ77::MIN_MATCH) out.push_back({(uint16_t)len, (uint16_t)delta});
+                }
+                if (len == len_limit) {
+                    // Full-length match: pos takes over cur_match's subtrees
+                    *ptr1 = pair[0];
+                    *ptr0 = pair[1];
+                    return;
+                }
+            }
+            if (pb[len] < cur[len]) {
+                *ptr1 = cur_match;
+                ptr1 = pair + 1;
+                cur_match = *ptr1;
+                len1 = len;
+            } else {
+                *ptr0 = cur_match;
+                ptr0 = pair;
+                cur_match = *ptr0;
+                len0 = len;
+            }
+        }
+    }
+
+private:
+    const uint8_t* data_;
+    size_t window_;
+    size_t cyclic_;
+    size_t max_depth_;
+    std::vector<uint32_t> head_;
+    std::vector<uint32_t> son_; // left/right child per cyclic slot
+};
+
+} // namespace
+
+std::vector<LZ77::Token> LZ77::compress(const std::vector<uint8_t>& data, size_t window, size_t lookahead, size_t max_chain, size_t dict_size) {
     std::vector<Token> tokens;
-    size_t pos = 0;
-    while (pos < data.size()) {
+    MatchState state;
+    compress(data.data(), data.size(), window, lookahead, max_chain, dict_size, state, tokens);
+    return tokens;
+}
+
+void LZ77::compress(const uint8_t* data, size_t n, size_t window, size_t lookahead, size_t max_chain, size_t dict_size,
+                    MatchState& state, std::vector<Token>& tokens) {
+    tokens.clear();
+    if (n <= dict_size) return;
+    // Token fields are 16-bit
+    window = std::min<size_t>(std::max<size_t>(window, 1), 0xFFFF);
+    lookahead = std::min<size_t>(lookahead, 0xFFFF);
+    tokens.reserve((n - dict_size) / 4 + 1);
+
+    // head[h] holds the most recent position whose prefix hashes to h;
+    // prev[] links each position to the previous one with the same hash.
+    // Positions are stored as base + p; anything below base is from an earlier input.
+    size_t ring = 1;
+    while (ring < window) ring <<= 1;
+    const size_t mask = ring - 1;
+    if (state.head.size() != (size_t(1) << HASH_BITS) || state.prev.size() != ring ||
+        uint64_t(state.base) + n >= NIL) {
+        state.head.assign(size_t(1) << HASH_BITS, NIL);
+        state.prev.assign(ring, NIL);
+        state.base = 0;
+    }
+    const uint32_t base = state.base;
+    uint32_t* head = state.head.data();
+    uint32_t* prev = state.prev.data();
+    auto insert = [&](size_t p) {
+        if (p + MIN_MATCH > n) return;
+        uint32_t h = hashPrefix(&data[p]);
+        uint32_t stored = base + static_cast<uint32_t>(p);
+        prev[stored & mask] = head[h];
+        head[h] = stored;
+    };
+
+    // Dictionary bytes are only indexed
+    for (size_t p = dict_size > window ? dict_size - window : 0; p < dict_size; ++p) insert(p);
+    size_t pos = dict_size;
+    while (pos < n) {
         size_t best_offset = 0, best_length = 0;
-        size_t start = pos >= window ? pos - window : 0;
-        for (size_t i = start; i < pos; ++i) {
-            size_t len = 0;
-            while (len < lookahead && pos + len < data.size() && data[i + len] == data[pos + len]) {
-                ++len;
+        size_t max_len = std::min(lookahead, n - pos);
+        if (max_len >= MIN_MATCH) {
+            uint32_t stored = head[hashPrefix(&data[pos])];
+            size_t chain = max_chain;
+            while (stored != NIL && stored >= base && chain-- > 0) {
+                size_t cand = stored - base;
+                size_t dist = pos - cand;
+                if (dist > window) break;
+                // Cheap reject: a longer match must also differ nowhere up to best_length
+                if (data[cand + best_length] == data[pos + best_length]) {
+                    size_t len = 0;
+                    while (len < max_len && data[cand + len] == data[pos + len]) ++len;
+                    if (len > best_length) {
+                        best_length = len;
+                        best_offset = dist;
+                        if (len == max_len) break;
+                    }
+                }
+                uint32_t next_stored = prev[stored & mask];
+                if (next_stored >= stored) break; // NIL, or a slot the ring has reused
+                stored = next_stored;
             }
-            if (len > best_length) {
-                best_length = len;
-                best_offset = pos - i;
+        }
+        if (best_length < MIN_MATCH) {
+            tokens.push_back({0, 0, data[pos]});
+            insert(pos++);
+            continue;
+        }
+        tokens.push_back({(uint16_t)best_offset, (uint16_t)best_length, 0});
+        for (size_t p = pos; p < pos + best_length; ++p) insert(p);
+        pos += best_length;
+    }
+    state.base = base + static_cast<uint32_t>(n);
+}
+
+std::vector<LZ77::Token> LZ77::compressOptimal(const std::vector<uint8_t>& data, const PriceModel& prices, size_t window, size_t lookahead, size_t max_depth, size_t dict_size) {
+    return compressOptimal(data.data(), data.size(), prices, window, lookahead, max_depth, dict_size);
+}
+
+std::vector<LZ77::Token> LZ77::compressOptimal(const uint8_t* data, size_t n, const PriceModel& prices, size_t window, size_t lookahead, size_t max_depth, size_t dict_size) {
+    std::vector<Token> tokens;
+    if (n <= dict_size) return tokens;
+    window = std::min<size_t>(std::max<size_t>(window, 1), std::min<size_t>(0xFFFF, prices.match_offset.size() - 1));
+    lookahead = std::min<size_t>(lookahead, std::min<size_t>(0xFFFF, prices.match_length.size() - 1));
+
+    // The parse settles OPTIMUM_WINDOW positions at a time, so cost and step stay
+    // fixed-size; a match that would cross the end of a window is cut there.
+    // cost[i] is the cheapest bit cost of encoding data[start..start+i); step[i] is the
+    // last token of that parse, a literal when its length is 0
+    struct Step {
+        uint16_t offset;
+        uint16_t length;
+    };
+    const uint64_t INF = ~uint64_t(0);
+    const size_t span = std::min(OPTIMUM_WINDOW, n - dict_size);
+    std::vector<uint64_t> cost(span + 1);
+    std::vector<Step> step(span + 1);
+
+    BinaryTreeMatchFinder finder(data, window, max_depth);
+    std::vector<Match> matches;
+    // Every position goes through the finder so the tree stays complete
+    auto findMatches = [&](size_t pos) {
+        size_t len_limit = std::min(lookahead, n - pos);
+        matches.clear();
+        if (len_limit >= MIN_MATCH) finder.findAndInsert(pos, len_limit, matches);
+    };
+    // Dictionary bytes are only indexed
+    for (size_t pos = dict_size > window ? dict_size - window : 0; pos < dict_size; ++pos) findMatches(pos);
+
+    for (size_t start = dict_size; start < n; start += span) {
+        const size_t size = std::min(span, n - start);
+        std::fill(cost.begin(), cost.begin() + size + 1, INF);
+        cost[0] = 0;
+        for (size_t i = 0; i < size; ++i) {
+            const size_t pos = start + i;
+            findMatches(pos);
+            uint64_t base = cost[i];
+            uint64_t lit = base + prices.literal_token + prices.literal[data[pos]];
+            if (lit < cost[i + 1]) {
+                cost[i + 1] = lit;
+                step[i + 1] = {0, 0};
+            }
+            // Match lengths that still end inside the window
+            const size_t len_room = size - i;
+            size_t prev_len = MIN_MATCH - 1;
+            for (const auto& m : matches) {
+                uint64_t off_cost = base + prices.match_offset[m.offset];
+                const size_t last = std::min<size_t>(m.length, len_room);
+                for (size_t len = prev_len + 1; len <= last; ++len) {
+                    uint64_t c = off_cost + prices.match_length[len];
+                    size_t end = i + len;
+                    if (c < cost[end]) {
+                        cost[end] = c;
+                        step[end] = {m.offset, (uint16_t)len};
+                    }
+                }
+                prev_len = m.length;
             }
         }
-        uint8_t next = pos + best_length < data.size() ? data[pos + best_length] : 0;
-        tokens.push_back({(uint16_t)best_offset, (uint16_t)best_length, next});
-        pos += best_length + 1;
+
+        // Backtrack from the end of the window; its tokens come out last first
+        const size_t first = tokens.size();
+        for (size_t i = size; i > 0;) {
+            const Step& token = step[i];
+            if (token.length == 0) {
+                tokens.push_back({0, 0, data[start + i - 1]});
+                --i;
+            } else {
+                tokens.push_back({token.offset, token.length, 0});
+                i -= token.length;
+            }
+        }
+        std::reverse(tokens.begin() + first, tokens.end());
     }
     return tokens;
 }
 
-std::vector<uint8_t> LZ77::decompress(const std::vector<Token>& tokens) {
-    std::vector<uint8_t> out;
-    for (const auto& t : tokens) {
-        size_t start = out.size() >= t.offset ? out.size() - t.offset : 0;
-        for (size_t i = 0; i < t.length; ++i) {
-            out.push_back(out[start + i]);
+LZ77::SymbolCode LZ77::lengthCode(size_t length) {
+    // 259-entry lookup built once: length -> index into LENGTH_BASE
+    static const std::vector<uint8_t> index = [] {
+        std::vector<uint8_t> t(MAX_MATCH + 1, 0);
+        for (unsigned code = 0; code < 29; ++code) {
+            size_t end = code + 1 < 29 ? LENGTH_BASE[code + 1] : MAX_MATCH + 1;
+            for (size_t len = LENGTH_BASE[code]; len < end; ++len) t[len] = static_cast<uint8_t>(code);
         }
-        out.push_back(t.next);
+        return t;
+    }();
+    unsigned code = index[length];
+    return {static_cast<uint16_t>(END_OF_BLOCK + 1 + code), LENGTH_EXTRA[code],
+            static_cast<uint16_t>(length - LENGTH_BASE[code])};
+}
+
+LZ77::SymbolCode LZ77::offsetCode(size_t offset) {
+    unsigned code = 0;
+    while (code + 1 < DIST_SYMBOLS && DIST_BASE[code + 1] <= offset) ++code;
+    return {static_cast<uint16_t>(code), DIST_EXTRA[code], static_cast<uint16_t>(offset - DIST_BASE[code])};
+}
+
+LZ77::PriceModel LZ77::symbolPrices(const std::vector<uint32_t>& litlen_bits, const std::vector<uint32_t>& dist_bits, size_t window, size_t lookahead) {
+    window = std::min(window, MAX_OFFSET);
+    lookahead = std::min(lookahead, MAX_MATCH);
+    PriceModel prices;
+    prices.literal.assign(litlen_bits.begin(), litlen_bits.begin() + 256);
+    prices.literal_token = 0;
+    prices.match_length.assign(lookahead + 1, 0);
+    for (size_t len = MIN_MATCH; len <= lookahead; ++len) {
+        SymbolCode c = lengthCode(len);
+        prices.match_length[len] = litlen_bits[c.symbol] + c.extra_bits;
     }
-    return out;
+    prices.match_offset.assign(window + 1, 0);
+    for (size_t off = 1; off <= window; ++off) {
+        SymbolCode c = offsetCode(off);
+        prices.match_offset[off] = dist_bits[c.symbol] + c.extra_bits;
+    }
+    return prices;
 }
 
-std::vector<uint8_t> LZ77::tokensToBytes(const std::vector<Token>& tokens) {
-    std::vector<uint8_t> bytes;
-    for (const auto& t : tokens) {
-        bytes.push_back(t.offset >> 8);
-        bytes.push_back(t.offset & 0xFF);
-        bytes.push_back(t.length >> 8);
-        bytes.push_back(t.length & 0xFF);
-        bytes.push_back(t.next);
+void LZ77::copyMatch(uint8_t* dst, size_t offset, size_t length) {
+    const uint8_t* src = dst - offset;
+    if (offset >= COPY_SLACK) {
+        // Each 16-byte block reads only bytes written before it
+        for (size_t i = 0; i < length; i += COPY_SLACK) std::memcpy(dst + i, src + i, COPY_SLACK);
+    } else if (offset == 1) {
+        std::memset(dst, src[0], length);
+    } else {
+        // Short overlap: repeat the period to 16 bytes, then store that pattern every
+        // `step` bytes, the largest multiple of the period that fits (16 for offsets 2 and 4)
+        uint8_t pattern[COPY_SLACK];
+        for (size_t i = 0; i < COPY_SLACK; ++i) pattern[i] = src[i % offset];
+        const size_t step = COPY_SLACK - COPY_SLACK % offset;
+        for (size_t i = 0; i < length; i += step) std::memcpy(dst + i, pattern, COPY_SLACK);
     }
-    return bytes;
 }
 
-std::vector<LZ77::Token> LZ77::bytesToTokens(const std::vector<uint8_t>& bytes) {
-    std::vector<Token> tokens;
-    for (size_t i = 0; i + 4 < bytes.size(); i += 5) {
-        uint16_t offset = (bytes[i] << 8) | bytes[i + 1];
-        uint16_t length = (bytes[i + 2] << 8) | bytes[i + 3];
-        uint8_t next = bytes[i + 4];
-        tokens.push_back({offset, length, next});
+std::vector<uint8_t> LZ77::decompress(const std::vector<Token>& tokens) {
+    size_t total = 0;
+    for (const auto& t : tokens) total += t.length > 0 ? t.length : 1;
+    std::vector<uint8_t> out(total + COPY_SLACK);
+    size_t pos = 0;
+    for (const auto& t : tokens) {
+        if (t.length == 0) {
+            out[pos++] = t.next;
+            continue;
+        }
+        if (t.offset >= 1 && t.offset <= pos) {
+            copyMatch(out.data() + pos, t.offset, t.length);
+        } else {
+            // Offsets reaching before the output copy from its start, one byte at a time
+            size_t start = pos >= t.offset ? pos - t.offset : 0;
+            for (size_t i = 0; i < t.length; ++i) out[pos + i] = out[start + i];
+        }
+        pos += t.length;
     }
-    return tokens;
+    out.resize(pos);
+    return out;
 }
@@ -0,0 +1,96 @@
+#include "../include/ThreadPool.h"
+
+namespace huffman {
+
+// Identifies the pool and deque of the current worker thread, if any
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local unsigned current_index = 0;
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    queues_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mtx_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) worker.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // A worker keeps its own tasks local; everyone else spreads them out
+    unsigned index = current_pool == this ? current_index : next_queue_.fetch_add(1) % size();
+    // Counting first keeps pending_ >= queued tasks, so it never drops below zero
+    {
+        std::lock_guard<std::mutex> lock(sleep_mtx_);
+        ++pending_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mtx);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::popTask(unsigned index, std::function<void()>& task) {
+    {
+        Queue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mtx);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (unsigned k = 1; k < size(); ++k) {
+        Queue& victim = *queues_[(index + k) % size()];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    current_pool = this;
+    current_index = index;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(sleep_mtx_);
+            wake_.wait(lock, [this] { return stop_ || pending_ > 0; });
+            if (pending_ == 0) return; // stopping and drained
+        }
+        std::function<void()> task;
+        // A counted task may not be pushed yet; look again
+        if (!popTask(index, task)) {
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mtx_);
+            --pending_;
+        }
+        try {
+            task();
+        } catch (...) {
+        }
+    }
+}
+
+} // namespace huffman
@@ -203,7 +203,24 @@ public:
         }
         auto start = chrono::high_resolution_clock::now();
         bool success = false;
-        if (hybrid) {
+        if (hybrid && parallel) {
+            // Large inputs: LZ77 + Huffman per chunk on all cores
+            settings.chunk_lz77 = true;
+            Compressor compressor;
+            success = compressor.compressParallel(opts.input_file, opts.output_file, settings, 1024 * 1024); // 1MB chunks
+            if (success) {
+                auto end = chrono::high_resolution_clock::now();
+                auto duration = chrono::duration<double, milli>(end - start).count();
+                size_t orig = filesystem::file_size(opts.input_file);
+                size_t comp = huffman::getCompressedFileSize(opts.output_file);
+                cout << "Compression successful!" << endl;
+                cout << "Original size: " << orig << " bytes (" << fixed << setprecision(2) << (orig/1024.0) << " KB)" << endl;
+                cout << "Compressed size: " << comp << " bytes (" << fixed << setprecision(2) << (comp/1024.0) << " KB)" << endl;
+                cout << "Compression ratio: " << fixed << setprecision(1)
+                          << (orig > 0 ? (double)comp / orig * 100.0 : 0.0) << "%" << endl;
+                cout << "Time: " << fixed << setprecision(2) << duration << " ms" << endl;
+            }
+        } else if (hybrid) {
             // Hybrid compression
             Compressor compressor;
             success = compressor.compressInternal(opts.input_file, opts.output_file, settings); // uses hybrid
@@ -452,7 +469,10 @@ int main(int argc, char* argv[]) {
                 cout << "Compression level (1-9, default 5): "; getline(cin, levelStr);
                 if (!levelStr.empty()) level = stoi(levelStr);
                 // Progress bar enabled by default
-                HuffmanCLI::compressFile({"compress", inPath, outPath, level, verbose, progress}, false, true);
+                // Large files are split into LZ77 + Huffman chunks compressed in parallel
+                size_t fileSize = filesystem::file_size(inPath);
+                bool useParallel = (fileSize > 1024 * 1024);
+                HuffmanCLI::compressFile({"compress", inPath, outPath, level, verbose, progress}, useParallel, true);
             } else if (choice == "3") {
                 string inName, outName, verifyStr;
                 bool verify = false, progress = true;